@@ -0,0 +1,244 @@
+#ifndef NODE_DECISION_ARENA_H
+#define NODE_DECISION_ARENA_H
+
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// Bump allocator holding the long-lived data of one device. Memory is handed
+// out from a few large chunks and returned all at once when the arena is
+// destroyed, so replacing a device's logic leaves no small holes in the heap.
+// An arena over a caller's buffer never grows: a request that does not fit
+// marks it exhausted and is served from the heap, so containers stay valid
+// until the owner sees exhausted() and throws the arena away.
+class NodeArena
+{
+public:
+    explicit NodeArena(size_t firstChunkSize = 1024) : nextChunkSize(firstChunkSize) {}
+    NodeArena(void *buffer, size_t size)
+        : head(static_cast<Chunk *>(buffer)), fixed(head), nextChunkSize(size), chunks(1)
+    {
+        head->next = nullptr;
+        head->size = size - sizeof(Chunk);
+        head->used = 0;
+    }
+    ~NodeArena() { release(); }
+    NodeArena(const NodeArena &) = delete;
+    NodeArena &operator=(const NodeArena &) = delete;
+
+    void *allocate(size_t size, size_t alignment)
+    {
+        if (head != nullptr)
+        {
+            uintptr_t base = reinterpret_cast<uintptr_t>(head->data());
+            uintptr_t aligned = (base + head->used + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+            size_t offset = static_cast<size_t>(aligned - base);
+            if (offset + size <= head->size)
+            {
+                head->used = offset + size;
+                bytes += size;
+                return head->data() + offset;
+            }
+        }
+        overflowed = fixed != nullptr;
+        // Chunks double in size, so a device needs only a handful of them
+        size_t chunkSize = nextChunkSize;
+        while (chunkSize < size + alignment)
+        {
+            chunkSize *= 2;
+        }
+        nextChunkSize = chunkSize * 2;
+        Chunk *chunk = static_cast<Chunk *>(::operator new(sizeof(Chunk) + chunkSize));
+        chunk->next = head;
+        chunk->size = chunkSize;
+        chunk->used = 0;
+        head = chunk;
+        chunks++;
+        return allocate(size, alignment);
+    }
+
+    void release()
+    {
+        while (head != nullptr && head != fixed)
+        {
+            Chunk *next = head->next;
+            ::operator delete(head);
+            head = next;
+        }
+        if (fixed != nullptr)
+        {
+            fixed->used = 0;
+        }
+        chunks = fixed != nullptr ? 1 : 0;
+        bytes = 0;
+        overflowed = false;
+    }
+
+    size_t chunkCount() const { return chunks; }
+    size_t bytesUsed() const { return bytes; }
+    bool exhausted() const { return overflowed; }
+
+private:
+    struct Chunk
+    {
+        Chunk *next;
+        size_t size;
+        size_t used;
+        uint8_t *data() { return reinterpret_cast<uint8_t *>(this + 1); }
+    };
+
+    Chunk *head = nullptr;
+    Chunk *fixed = nullptr; // the caller's buffer, never freed
+    size_t nextChunkSize;
+    size_t chunks = 0;
+    size_t bytes = 0;
+    bool overflowed = false;
+};
+
+// Storage for Count arenas over buffers of Bytes each, held in place so that
+// arena memory never comes from the heap
+template <size_t Count, size_t Bytes>
+class NodeArenaPool
+{
+    static_assert(Bytes >= 256, "NDL_ARENA_BYTES is too small to hold any logic");
+
+public:
+    NodeArenaPool()
+    {
+        for (size_t k = 0; k < Count; k++)
+        {
+            used[k] = false;
+        }
+    }
+    NodeArenaPool(const NodeArenaPool &) = delete;
+    NodeArenaPool &operator=(const NodeArenaPool &) = delete;
+
+    // Null when every arena is taken
+    NodeArena *acquire()
+    {
+        for (size_t k = 0; k < Count; k++)
+        {
+            if (!used[k])
+            {
+                used[k] = true;
+                return new (&slots[k].arena) NodeArena(slots[k].buffer, Bytes);
+            }
+        }
+        return nullptr;
+    }
+
+    void release(NodeArena *arena)
+    {
+        for (size_t k = 0; k < Count; k++)
+        {
+            if (used[k] && arena == reinterpret_cast<NodeArena *>(&slots[k].arena))
+            {
+                arena->~NodeArena();
+                used[k] = false;
+            }
+        }
+    }
+
+private:
+    struct Slot
+    {
+        alignas(alignof(max_align_t)) uint8_t buffer[Bytes];
+        typename std::aligned_storage<sizeof(NodeArena), alignof(NodeArena)>::type arena;
+    };
+    Slot slots[Count];
+    bool used[Count];
+};
+
+// Allocator bound to the arena it was constructed with, or to the heap when
+// default constructed. Like std::pmr, the container decides where memory
+// comes from: assignments and copies into a container keep its arena, and
+// elements that take an allocator (nested containers, structs declaring
+// allocator_type) are built in the arena of the container holding them.
+// Copy construction allocates from the heap, so scratch copies of a device's
+// data do not grow its arena. Swapping containers of different arenas is
+// undefined, as it is for std::pmr.
+template <typename T>
+class NodeArenaAllocator
+{
+public:
+    typedef T value_type;
+    typedef std::false_type propagate_on_container_copy_assignment;
+    typedef std::false_type propagate_on_container_move_assignment;
+    typedef std::false_type propagate_on_container_swap;
+
+    NodeArenaAllocator() : arena(nullptr) {}
+    explicit NodeArenaAllocator(NodeArena *arena) : arena(arena) {}
+    template <typename U>
+    NodeArenaAllocator(const NodeArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t count)
+    {
+        if (arena != nullptr)
+        {
+            return static_cast<T *>(arena->allocate(count * sizeof(T), alignof(T)));
+        }
+        return static_cast<T *>(::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(T *pointer, size_t)
+    {
+        // Arena memory is reclaimed when the arena goes away
+        if (arena == nullptr)
+        {
+            ::operator delete(pointer);
+        }
+    }
+
+    // Uses-allocator construction with a trailing allocator argument
+    template <typename U, typename... Args>
+    void construct(U *pointer, Args &&...args)
+    {
+        constructWith(std::uses_allocator<U, NodeArenaAllocator>(), pointer, std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    void destroy(U *pointer) { pointer->~U(); }
+
+    NodeArenaAllocator select_on_container_copy_construction() const { return NodeArenaAllocator(); }
+
+    template <typename U>
+    bool operator==(const NodeArenaAllocator<U> &other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const NodeArenaAllocator<U> &other) const { return arena != other.arena; }
+
+private:
+    template <typename U>
+    friend class NodeArenaAllocator;
+
+    template <typename U, typename... Args>
+    void constructWith(std::true_type, U *pointer, Args &&...args)
+    {
+        ::new (static_cast<void *>(pointer)) U(std::forward<Args>(args)..., *this);
+    }
+    template <typename U, typename... Args>
+    void constructWith(std::false_type, U *pointer, Args &&...args)
+    {
+        ::new (static_cast<void *>(pointer)) U(std::forward<Args>(args)...);
+    }
+
+    NodeArena *arena;
+};
+
+// Allocator of type Alloc for the arena. Allocators that cannot be bound to an
+// arena, such as std::allocator, are default constructed and use the heap.
+template <typename Alloc>
+typename std::enable_if<std::is_constructible<Alloc, NodeArena *>::value, Alloc>::type arenaAllocator(NodeArena *arena)
+{
+    return Alloc(arena);
+}
+
+template <typename Alloc>
+typename std::enable_if<!std::is_constructible<Alloc, NodeArena *>::value, Alloc>::type arenaAllocator(NodeArena *)
+{
+    return Alloc();
+}
+
+#endif
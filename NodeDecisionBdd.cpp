@@ -0,0 +1,199 @@
+#include "NodeDecisionBdd.h"
+#include <set>
+#include <utility>
+
+// Heap tables start small and double up to the limit
+static const size_t BDD_HEAP_FIRST_CAPACITY = 64;
+
+BddBuilder::BddBuilder(size_t nodeLimit)
+    : nodes(nullptr), unique(nullptr), computed(nullptr), capacity(0), nodeLimit(nodeLimit), growable(true)
+{
+    grow();
+    reset();
+}
+
+BddBuilder::BddBuilder(BddNode *nodes, uint32_t *unique, BddComputed *computed, size_t capacity)
+    : nodes(nodes), unique(unique), computed(computed), capacity(capacity), nodeLimit(capacity), growable(false)
+{
+    for (size_t i = 0; i < capacity; i++)
+    {
+        computed[i].generation = 0;
+    }
+    reset();
+}
+
+// Leaves only the two constants
+void BddBuilder::reset()
+{
+    nodes[BDD_FALSE] = {BDD_TERMINAL_VAR, BDD_FALSE, BDD_FALSE};
+    nodes[BDD_TRUE] = {BDD_TERMINAL_VAR, BDD_TRUE, BDD_TRUE};
+    count = 2;
+    rehash();
+}
+
+bool BddBuilder::grow()
+{
+    if (!growable || capacity >= nodeLimit)
+    {
+        return false;
+    }
+    capacity = capacity == 0 ? BDD_HEAP_FIRST_CAPACITY : capacity * 2;
+    if (capacity > nodeLimit)
+    {
+        capacity = nodeLimit;
+    }
+    heapNodes.resize(capacity);
+    heapUnique.resize(2 * capacity);
+    heapComputed.assign(capacity, BddComputed{0, 0, 0, 0});
+    nodes = heapNodes.data();
+    unique = heapUnique.data();
+    computed = heapComputed.data();
+    if (count > 0)
+    {
+        rehash();
+    }
+    return true;
+}
+
+// Refills the unique table from the node table
+void BddBuilder::rehash()
+{
+    for (size_t i = 0; i < 2 * capacity; i++)
+    {
+        unique[i] = 0;
+    }
+    for (uint32_t i = BDD_TRUE + 1; i < count; i++)
+    {
+        *uniqueSlot(nodes[i].var, nodes[i].low, nodes[i].high) = i;
+    }
+}
+
+// Entry of the unique table holding the node, or the empty entry where it goes
+uint32_t *BddBuilder::uniqueSlot(uint32_t var, uint32_t low, uint32_t high)
+{
+    const size_t size = 2 * capacity;
+    size_t index = (var * 0x9E3779B1u ^ low * 0x85EBCA77u ^ high * 0xC2B2AE3Du) % size;
+    while (unique[index] != 0)
+    {
+        const BddNode &node = nodes[unique[index]];
+        if (node.var == var && node.low == low && node.high == high)
+        {
+            break;
+        }
+        index = (index + 1) % size;
+    }
+    return &unique[index];
+}
+
+uint32_t BddBuilder::variable(uint32_t var)
+{
+    return makeNode(var, BDD_FALSE, BDD_TRUE);
+}
+
+uint32_t BddBuilder::apply(LogicKernel kernel, uint32_t a, uint32_t b)
+{
+    generation++; // Results of other kernels no longer apply
+    return applyRecursive(kernel, a, b);
+}
+
+void BddBuilder::rollback(size_t nodeCount)
+{
+    count = nodeCount;
+    rehash();
+    generation++;
+    overflow = false;
+}
+
+uint32_t BddBuilder::makeNode(uint32_t var, uint32_t low, uint32_t high)
+{
+    if (low == high)
+    {
+        return low; // Redundant test
+    }
+
+    uint32_t *slot = uniqueSlot(var, low, high);
+    if (*slot != 0)
+    {
+        return *slot;
+    }
+
+    if (count >= capacity)
+    {
+        if (!grow())
+        {
+            overflow = true;
+            return BDD_FALSE;
+        }
+        slot = uniqueSlot(var, low, high);
+    }
+    uint32_t index = static_cast<uint32_t>(count++);
+    nodes[index] = {var, low, high};
+    *slot = index;
+    return index;
+}
+
+uint32_t BddBuilder::applyRecursive(LogicKernel kernel, uint32_t a, uint32_t b)
+{
+    if (a <= BDD_TRUE && b <= BDD_TRUE)
+    {
+        const bool inputs[2] = {a == BDD_TRUE, b == BDD_TRUE};
+        return constant(kernel(inputs));
+    }
+    if (overflow)
+    {
+        return BDD_FALSE;
+    }
+
+    const size_t cacheIndex = (a * 0x9E3779B1u ^ b * 0x85EBCA77u) % capacity;
+    const BddComputed &cached = computed[cacheIndex];
+    if (cached.generation == generation && cached.a == a && cached.b == b)
+    {
+        return cached.result;
+    }
+
+    // Shannon expansion on the lowest variable of either operand
+    const uint32_t varA = nodes[a].var;
+    const uint32_t varB = nodes[b].var;
+    const uint32_t var = varA < varB ? varA : varB;
+    const uint32_t aLow = varA == var ? nodes[a].low : a;
+    const uint32_t aHigh = varA == var ? nodes[a].high : a;
+    const uint32_t bLow = varB == var ? nodes[b].low : b;
+    const uint32_t bHigh = varB == var ? nodes[b].high : b;
+
+    uint32_t low = applyRecursive(kernel, aLow, bLow);
+    uint32_t high = applyRecursive(kernel, aHigh, bHigh);
+    uint32_t result = makeNode(var, low, high);
+    if (!overflow)
+    {
+        // The tables may have grown during the recursion
+        computed[(a * 0x9E3779B1u ^ b * 0x85EBCA77u) % capacity] = {a, b, result, generation};
+    }
+    return result;
+}
+
+static bool bddEquivalentRecursive(const BddNode *nodesA, uint32_t a, const int64_t *keysA,
+                                   const BddNode *nodesB, uint32_t b, const int64_t *keysB,
+                                   std::set<std::pair<uint32_t, uint32_t>> &visited)
+{
+    if (a <= BDD_TRUE || b <= BDD_TRUE)
+    {
+        return a == b;
+    }
+    if (!visited.insert(std::make_pair(a, b)).second)
+    {
+        return true;
+    }
+    if (keysA[nodesA[a].var] != keysB[nodesB[b].var])
+    {
+        return false;
+    }
+    return bddEquivalentRecursive(nodesA, nodesA[a].low, keysA, nodesB, nodesB[b].low, keysB, visited) &&
+           bddEquivalentRecursive(nodesA, nodesA[a].high, keysA, nodesB, nodesB[b].high, keysB, visited);
+}
+
+bool bddEquivalent(const BddNode *nodesA, uint32_t rootA, const int64_t *keysA,
+                   const BddNode *nodesB, uint32_t rootB, const int64_t *keysB)
+{
+    std::set<std::pair<uint32_t, uint32_t>> visited;
+    return bddEquivalentRecursive(nodesA, rootA, keysA, nodesB, rootB, keysB, visited);
+}
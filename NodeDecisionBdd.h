@@ -0,0 +1,105 @@
+#ifndef NODE_DECISION_BDD_H
+#define NODE_DECISION_BDD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "NodeDecisionKinds.h"
+
+// Reduced ordered binary decision diagram node. Entries 0 and 1 of a node
+// table are the constants false and true; lower variables are tested first.
+struct BddNode
+{
+    uint32_t var;
+    uint32_t low;
+    uint32_t high;
+};
+
+static const uint32_t BDD_FALSE = 0;
+static const uint32_t BDD_TRUE = 1;
+static const uint32_t BDD_TERMINAL_VAR = 0xFFFFFFFF;
+
+// Entry of the cache of apply results, valid for the apply of its generation
+struct BddComputed
+{
+    uint32_t a;
+    uint32_t b;
+    uint32_t result;
+    uint32_t generation;
+};
+
+// Tables of a BddBuilder held in place, for builds that never touch the heap
+template <size_t Capacity>
+struct BddPool
+{
+    BddNode nodes[Capacity];
+    uint32_t unique[2 * Capacity];
+    BddComputed computed[Capacity];
+};
+
+// Builds diagrams into a node table of its own. Gates are applied with the
+// logic kernels from the kind table, so every boolean kind is supported.
+// Nodes are found again through an open-addressing table, and apply results
+// are remembered in a cache that may drop entries. The tables either live on
+// the heap and grow with the diagrams, or live in a BddPool and never grow.
+class BddBuilder
+{
+public:
+    explicit BddBuilder(size_t nodeLimit);
+    template <size_t Capacity>
+    explicit BddBuilder(BddPool<Capacity> &pool) : BddBuilder(pool.nodes, pool.unique, pool.computed, Capacity) {}
+    BddBuilder(const BddBuilder &) = delete;
+    BddBuilder &operator=(const BddBuilder &) = delete;
+
+    uint32_t constant(bool value) const { return value ? BDD_TRUE : BDD_FALSE; }
+    uint32_t variable(uint32_t var);
+    uint32_t apply(LogicKernel kernel, uint32_t a, uint32_t b);
+    bool overflowed() const { return overflow; }
+    const BddNode *data() const { return nodes; }
+    size_t size() const { return count; }
+    // Drops every node from nodeCount on and clears the overflow, so the
+    // diagrams built before that point can still be extended
+    void rollback(size_t nodeCount);
+
+private:
+    BddBuilder(BddNode *nodes, uint32_t *unique, BddComputed *computed, size_t capacity);
+
+    std::vector<BddNode> heapNodes; // storage when not given a pool
+    std::vector<uint32_t> heapUnique;
+    std::vector<BddComputed> heapComputed;
+    BddNode *nodes;
+    uint32_t *unique;       // 2 * capacity entries: node index, 0 if empty
+    BddComputed *computed;  // capacity entries
+    size_t capacity;        // nodes the tables hold now
+    size_t nodeLimit;
+    size_t count = 0;
+    uint32_t generation = 1;
+    bool growable;
+    bool overflow = false;
+
+    void reset();
+    bool grow();
+    void rehash();
+    uint32_t *uniqueSlot(uint32_t var, uint32_t low, uint32_t high);
+    uint32_t makeNode(uint32_t var, uint32_t low, uint32_t high);
+    uint32_t applyRecursive(LogicKernel kernel, uint32_t a, uint32_t b);
+};
+
+// Walks from root to a terminal; assignment[var] is the value of each variable
+template <typename Assignment>
+bool bddEvaluate(const BddNode *nodes, uint32_t root, const Assignment &assignment)
+{
+    while (root > BDD_TRUE)
+    {
+        const BddNode &node = nodes[root];
+        root = assignment(node.var) ? node.high : node.low;
+    }
+    return root == BDD_TRUE;
+}
+
+// True when two diagrams are the same function. Variables are matched by key,
+// which is canonical when both tables order their variables by the same keys.
+bool bddEquivalent(const BddNode *nodesA, uint32_t rootA, const int64_t *keysA,
+                   const BddNode *nodesB, uint32_t rootB, const int64_t *keysB);
+
+#endif
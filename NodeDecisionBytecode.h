@@ -0,0 +1,137 @@
+#ifndef NODE_DECISION_BYTECODE_H
+#define NODE_DECISION_BYTECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+// Flat register program for one device. Registers are the plan's output
+// slots followed by one register per literal; every instruction names its
+// registers directly, so the interpreter never allocates or searches.
+
+enum Opcode : uint8_t
+{
+    OP_LOAD_SENSOR, // target = sensor value of deviceId immediate, unchanged if never received;
+                    // a holds the engine's slot for that sensor and is 0 in images
+    OP_LOAD_CONST,  // target = constants[immediate]
+    OP_APPLY,       // target = kind(a, b); kind is an availableId from the kind table
+    OP_STORE_SLOT,  // target = a, for nodes with more than one output
+    OP_EMIT_FINAL,  // final node immediate reads a and drives the callback on change
+    OP_COUNT
+};
+
+struct Instruction
+{
+    uint8_t opcode;
+    uint8_t kind;
+    uint16_t target;
+    uint16_t a;
+    uint16_t b;
+    int32_t immediate;
+};
+
+// Serialized layout, little endian:
+//   "NDBC" version:u8 registers:u32 constants:u32 instructions:u32 finals:u32
+//   constants: type:u8 then bool:u8 | int:i64 | double:f64 | string:u16 length + bytes
+//   instructions: opcode:u8 kind:u8 target:u16 a:u16 b:u16 immediate:i32
+//   finals: final node id:i32
+//   checksum: CRC-32 of every byte before it:u32
+static const uint8_t BYTECODE_MAGIC[4] = {'N', 'D', 'B', 'C'};
+static const uint8_t BYTECODE_VERSION = 2;
+static const uint32_t BYTECODE_MAX_REGISTERS = 0xFFFF;
+
+// CRC-32 (IEEE 802.3, as used by zlib), computed bit by bit so it needs no table
+inline uint32_t bytecodeChecksum(const uint8_t *data, size_t size)
+{
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+class BytecodeWriter
+{
+public:
+    explicit BytecodeWriter(std::vector<uint8_t> &bytes) : bytes(bytes) {}
+
+    void u8(uint8_t value) { bytes.push_back(value); }
+    void u16(uint16_t value) { little(value, 2); }
+    void u32(uint32_t value) { little(value, 4); }
+    void u64(uint64_t value) { little(value, 8); }
+    void raw(const void *data, size_t size)
+    {
+        const uint8_t *begin = static_cast<const uint8_t *>(data);
+        bytes.insert(bytes.end(), begin, begin + size);
+    }
+
+private:
+    std::vector<uint8_t> &bytes;
+
+    void little(uint64_t value, int size)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+};
+
+// Reads fail softly: past the end every read returns zero and ok() turns false
+class BytecodeReader
+{
+public:
+    BytecodeReader(const uint8_t *data, size_t size) : data(data), size(size) {}
+
+    uint8_t u8() { return static_cast<uint8_t>(little(1)); }
+    uint16_t u16() { return static_cast<uint16_t>(little(2)); }
+    uint32_t u32() { return static_cast<uint32_t>(little(4)); }
+    uint64_t u64() { return little(8); }
+    bool raw(void *out, size_t length)
+    {
+        if (!take(length))
+            return false;
+        memcpy(out, data + position - length, length);
+        return true;
+    }
+    // The next length bytes in place, or null past the end
+    const uint8_t *view(size_t length) { return take(length) ? data + position - length : nullptr; }
+    bool ok() const { return !failed; }
+    size_t remaining() const { return failed ? 0 : size - position; }
+
+private:
+    const uint8_t *data;
+    size_t size;
+    size_t position = 0;
+    bool failed = false;
+
+    bool take(size_t length)
+    {
+        if (failed || size - position < length)
+        {
+            failed = true;
+            return false;
+        }
+        position += length;
+        return true;
+    }
+    uint64_t little(int length)
+    {
+        if (!take(length))
+            return 0;
+        uint64_t value = 0;
+        for (int i = 0; i < length; i++)
+        {
+            value |= static_cast<uint64_t>(data[position - length + i]) << (8 * i);
+        }
+        return value;
+    }
+};
+
+#endif
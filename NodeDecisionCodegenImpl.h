@@ -0,0 +1,195 @@
+#ifndef NODE_DECISION_CODEGEN_IMPL_H
+#define NODE_DECISION_CODEGEN_IMPL_H
+
+#include "NodeDecisionLibrary.h"
+#include "NodeDecisionLog.h"
+#include <algorithm>
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+
+// Number literal for generated source, exact for every finite double
+inline std::string numberLiteral(double value)
+{
+    if (isnan(value))
+        return "NAN";
+    if (isinf(value))
+        return value > 0 ? "INFINITY" : "-INFINITY";
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.17g", value);
+    std::string text = buffer;
+    if (text.find_first_of(".eEn") == std::string::npos)
+    {
+        text += ".0";
+    }
+    return text;
+}
+
+// Emits a C++ header with one struct that evaluates the device's compiled graph
+// in straight-line code. Nodes call the scalar kernels from NodeDecisionKinds.h
+// by name, so the compiler can inline the whole evaluation. Fails for graphs
+// that read string sensors or compare strings, which generated code cannot represent.
+template <typename Policies>
+bool NodeDecisionEngine<Policies>::generateCode(int deviceId, const char *name, std::string &source)
+{
+    auto planIt = devicePlans.find(deviceId);
+    if (planIt == devicePlans.end() || name == nullptr || !(isalpha(name[0]) || name[0] == '_'))
+    {
+        return false;
+    }
+    for (const char *c = name; *c; c++)
+    {
+        if (!isalnum(*c) && *c != '_')
+            return false;
+    }
+    const auto &plan = planIt->second;
+    const auto &nodes = deviceNodes[deviceId];
+
+    // Live slots get a name when their node is emitted; anything else is a literal.
+    // Generated code carries numbers only, so strings cannot be expressed.
+    std::vector<std::string> slotName(plan.slotCount);
+    std::vector<bool> slotIsBool(plan.slotCount, false);
+    int stringNodeId = -1;
+    auto operand = [&](int nodeIndex, size_t i, bool asBool)
+    {
+        const auto &node = nodes[nodeIndex];
+        NodeValue literal;
+        if (i < node.inputs.size())
+        {
+            int source = plan.inputSources[nodeIndex][i];
+            if (source >= 0 && !slotName[source].empty())
+            {
+                const std::string &slot = slotName[source];
+                if (asBool == slotIsBool[source])
+                    return slot;
+                return asBool ? "(" + slot + " != 0.0)" : "(" + slot + " ? 1.0 : 0.0)";
+            }
+            literal = source >= 0 ? slotValue(plan, source) : node.inputs[i].data;
+        }
+        // Equality against a string literal means the logic compares strings
+        if (literal.type == NodeValue::String && (node.availableId == NODE_KIND_EQUAL || node.availableId == NODE_KIND_NOT_EQUAL))
+        {
+            stringNodeId = node.id;
+        }
+        return asBool ? std::string(valueToBool(literal) ? "true" : "false") : numberLiteral(valueToNumber(literal));
+    };
+
+    std::vector<int> sensors;
+    int finalCount = 0;
+    std::string body;
+    for (int nodeIndex : plan.graphOrder)
+    {
+        const auto &node = nodes[nodeIndex];
+        const NodeKind &kind = nodeKindFor(node.availableId);
+        const int outputSlot = plan.outputSlotBase[nodeIndex];
+        const std::string slot = std::to_string(outputSlot);
+
+        switch (kind.category)
+        {
+        case NODE_DEVICE_INPUT:
+            for (size_t i = 0; i < node.outputs.size(); i++)
+            {
+                if (internedStrings[node.outputs[i].dataType].text == "string")
+                {
+                    stringNodeId = node.id;
+                }
+                size_t k = std::find(sensors.begin(), sensors.end(), node.outputs[i].deviceId) - sensors.begin();
+                if (k == sensors.size())
+                {
+                    sensors.push_back(node.outputs[i].deviceId);
+                }
+                slotName[outputSlot + i] = "sensors[" + std::to_string(k) + "]";
+            }
+            break;
+
+        case NODE_FINAL:
+            if (!node.inputs.empty())
+            {
+                const std::string k = std::to_string(finalCount++);
+                body += "        const bool final" + k + " = " + operand(nodeIndex, 0, true) + "; // Final Node ID " +
+                        std::to_string(node.id) + "\n";
+                body += "        if (finalState[" + k + "] != static_cast<int8_t>(final" + k + "))\n";
+                body += "        {\n";
+                body += "            finalState[" + k + "] = final" + k + ";\n";
+                body += "            callback(deviceId, final" + k + ");\n";
+                body += "        }\n";
+            }
+            break;
+
+        case NODE_LOGIC:
+        case NODE_MATH:
+        case NODE_COMPARE:
+        {
+            if (node.outputs.empty())
+                break;
+            const bool inputsBool = kind.category == NODE_LOGIC;
+            const bool resultBool = kind.category != NODE_MATH;
+            const std::string a = operand(nodeIndex, 0, inputsBool);
+            const std::string b = kind.arity > 1 ? operand(nodeIndex, 1, inputsBool) : a;
+            body += std::string("        const ") + (inputsBool ? "bool" : "double") + " in" + slot + "[2] = {" + a + ", " + b + "};\n";
+            body += std::string("        const ") + (resultBool ? "bool" : "double") + " v" + slot + " = " + kind.symbol + "(in" + slot +
+                    "); // Node ID " + std::to_string(node.id) + " " + kind.name + "\n";
+            for (size_t i = 0; i < node.outputs.size(); i++)
+            {
+                slotName[outputSlot + i] = "v" + slot;
+                slotIsBool[outputSlot + i] = resultBool;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+    if (stringNodeId >= 0)
+    {
+        NDL_ERROR(COMPILE, "Device ID %d: Node ID %d uses strings; generated code supports numbers and booleans only\n",
+                           deviceId, stringNodeId);
+        return false;
+    }
+    if (finalCount == 0)
+    {
+        body += "        (void)callback;\n";
+    }
+
+    std::string guard;
+    for (const char *c = name; *c; c++)
+    {
+        guard += static_cast<char>(toupper(*c));
+    }
+    guard += "_H";
+
+    source = "// Generated by NodeDecisionLibrary::generateCode from the logic of Device ID " + std::to_string(deviceId) + ".\n";
+    source += "// Sensor values are numbers, booleans as 0/1; sensors never set read as 0.\n";
+    source += "#ifndef " + guard + "\n#define " + guard + "\n\n";
+    source += "#include <stdint.h>\n#include \"NodeDecisionKinds.h\"\n\n";
+    source += "struct " + std::string(name) + "\n{\n";
+    source += "    enum : int { deviceId = " + std::to_string(deviceId) + " };\n";
+    source += "    double sensors[" + std::to_string(std::max<size_t>(sensors.size(), 1)) + "] = {};\n";
+    source += "    int8_t finalState[" + std::to_string(std::max(finalCount, 1)) + "] = {";
+    for (int k = 0; k < std::max(finalCount, 1); k++)
+    {
+        source += k ? ", -1" : "-1";
+    }
+    source += "};\n\n";
+
+    source += "    // Returns false when this logic does not read the sensor\n";
+    source += "    bool setSensor(int sensorId, double value)\n    {\n        switch (sensorId)\n        {\n";
+    for (size_t k = 0; k < sensors.size(); k++)
+    {
+        source += "        case " + std::to_string(sensors[k]) + ":\n";
+        source += "            sensors[" + std::to_string(k) + "] = value;\n            return true;\n";
+    }
+    source += "        default:\n            (void)value;\n            return false;\n        }\n    }\n\n";
+
+    source += "    // Evaluates every node once and calls callback(deviceId, value) for each\n";
+    source += "    // final node whose value changed. Debouncing is left to the caller.\n";
+    source += "    template <typename Callback>\n    void evaluate(Callback &&callback)\n    {\n";
+    source += body;
+    source += "    }\n};\n\n#endif\n";
+
+    NDL_INFO(COMPILE, "Generated %d bytes of code for Device ID %d\n", static_cast<int>(source.size()), deviceId);
+    return true;
+}
+
+#endif
@@ -0,0 +1,3013 @@
+#ifndef NODE_DECISION_ENGINE_IMPL_H
+#define NODE_DECISION_ENGINE_IMPL_H
+
+#include "NodeDecisionLibrary.h"
+#include "NodeDecisionLog.h"
+#include <ArduinoJson.h>
+#include <algorithm>
+#include <errno.h>
+#include <queue>
+#include <set>
+#include <string.h>
+
+// Constructor
+template <typename Policies>
+NodeDecisionEngine<Policies>::NodeDecisionEngine()
+{
+#ifdef NDL_FIXED_CAPACITY
+    // Tables bounded by the limits get their storage up front
+    sensors.reserve(NDL_MAX_SENSORS);
+    deviceStates.reserve(NDL_MAX_DEVICES);
+    readyNodes.reserve(NDL_MAX_NODES_PER_DEVICE);
+    internedStrings.reserve(NDL_MAX_STRINGS);
+    freeStrings.reserve(NDL_MAX_STRINGS);
+    unusedStrings.reserve(NDL_MAX_STRINGS);
+#endif
+}
+
+template <typename Policies>
+void NodeDecisionEngine<Policies>::isDebug(bool enabled)
+{
+    debugEnabled = enabled;
+}
+
+template <typename Policies>
+void NodeDecisionEngine<Policies>::debugPrint(const char *format, ...)
+{
+    if (debugEnabled)
+    {
+        va_list args;
+        va_start(args, format);
+        Logger::write(format, args);
+        va_end(args);
+    }
+}
+
+template <typename Policies>
+uint32_t NodeDecisionEngine<Policies>::internString(const char *text, size_t length)
+{
+    typedef typename StringIndex::key_type Key;
+    auto it = internIndex.find(Key(text, length));
+    if (it != internIndex.end())
+    {
+        return it->second;
+    }
+
+    uint32_t handle;
+#if NDL_MAX_STRING_LENGTH > 0
+    if (length > NDL_MAX_STRING_LENGTH)
+    {
+        NDL_WARN(DECODE, "String of %d bytes is longer than %d, not stored\n", static_cast<int>(length), NDL_MAX_STRING_LENGTH);
+        stringsFull = true;
+        return NO_STRING;
+    }
+#endif
+    if (!freeStrings.empty())
+    {
+        handle = freeStrings.back();
+        freeStrings.pop_back();
+    }
+#if NDL_MAX_STRINGS > 0
+    else if (internedStrings.size() >= NDL_MAX_STRINGS)
+    {
+        NDL_WARN(DECODE, "String table full (%d entries), \"%.*s\" not stored\n", NDL_MAX_STRINGS, static_cast<int>(length), text);
+        stringsFull = true;
+        return NO_STRING;
+    }
+#endif
+    else
+    {
+        handle = static_cast<uint32_t>(internedStrings.size());
+        internedStrings.push_back(InternedString());
+    }
+
+    InternedString &entry = internedStrings[handle];
+    entry.text.assign(text, length);
+    entry.boolValue = textToBool(entry.text.c_str(), length);
+    char *end = nullptr;
+    entry.numberValue = strtod(entry.text.c_str(), &end);
+    if (end == entry.text.c_str())
+    {
+        entry.numberValue = 0.0; // Not numeric
+    }
+    entry.sensorRefs = 0;
+    entry.logicRef = false;
+    entry.inUse = true;
+    entry.queued = false;
+    // Keyed by the entry's own copy of the text, which stays in place
+    internIndex.emplace(Key(entry.text.data(), entry.text.size()), handle);
+    return handle;
+}
+
+// Lists a string that may have lost its last holder, once
+template <typename Policies>
+void NodeDecisionEngine<Policies>::queueUnused(uint32_t handle)
+{
+    if (!internedStrings[handle].queued)
+    {
+        internedStrings[handle].queued = true;
+        unusedStrings.push_back(handle);
+    }
+}
+
+// Replaces a sensor's value, keeping the string reference counts in step. A
+// string that loses its last holder is only queued: slots may still hold its
+// handle until the update that replaced it has been evaluated.
+template <typename Policies>
+void NodeDecisionEngine<Policies>::setSensorValue(SensorState &sensor, const NodeValue &value)
+{
+    if (value.type == NodeValue::String)
+    {
+        internedStrings[value.s].sensorRefs++;
+    }
+    if (sensor.value.type == NodeValue::String)
+    {
+        InternedString &entry = internedStrings[sensor.value.s];
+        if (--entry.sensorRefs == 0 && !entry.logicRef)
+        {
+            queueUnused(sensor.value.s);
+        }
+    }
+    sensor.value = value;
+}
+
+// Frees a string once no sensor holds it and no logic reads it
+template <typename Policies>
+void NodeDecisionEngine<Policies>::freeIfUnused(uint32_t handle)
+{
+    InternedString &entry = internedStrings[handle];
+    entry.queued = false;
+    if (entry.inUse && entry.sensorRefs == 0 && !entry.logicRef)
+    {
+        internIndex.erase(typename StringIndex::key_type(entry.text.data(), entry.text.size()));
+        StringText().swap(entry.text);
+        entry.inUse = false;
+        freeStrings.push_back(handle);
+    }
+}
+
+template <typename Policies>
+void NodeDecisionEngine<Policies>::reclaimStrings()
+{
+    for (uint32_t handle : unusedStrings)
+    {
+        freeIfUnused(handle);
+    }
+    unusedStrings.clear();
+}
+
+// Recomputes which strings the installed logic reads, then frees every string
+// nothing holds, including those interned by a decode that was rejected
+template <typename Policies>
+void NodeDecisionEngine<Policies>::sweepStrings()
+{
+    for (InternedString &entry : internedStrings)
+    {
+        entry.logicRef = false;
+    }
+    auto mark = [this](const NodeValue &value)
+    {
+        if (value.type == NodeValue::String)
+            internedStrings[value.s].logicRef = true;
+    };
+    for (const auto &entry : deviceNodes)
+    {
+        for (const auto &node : entry.second)
+        {
+            internedStrings[node.kind].logicRef = true;
+            for (const auto &input : node.inputs)
+            {
+                internedStrings[input.dataType].logicRef = true;
+                mark(input.data);
+            }
+            for (const auto &output : node.outputs)
+            {
+                internedStrings[output.dataType].logicRef = true;
+            }
+        }
+    }
+    for (const auto &entry : devicePrograms)
+    {
+        for (const NodeValue &value : entry.second.constants)
+        {
+            mark(value);
+        }
+    }
+
+    for (size_t handle = 0; handle < internedStrings.size(); handle++)
+    {
+        freeIfUnused(static_cast<uint32_t>(handle));
+    }
+    unusedStrings.clear();
+}
+
+template <typename Policies>
+NodeValue NodeDecisionEngine<Policies>::valueFromJson(JsonVariant value)
+{
+    if (value.isNull())
+    {
+        return NodeValue();
+    }
+    if (value.is<bool>())
+    {
+        return NodeValue::fromBool(value.as<bool>());
+    }
+    if (value.is<int64_t>())
+    {
+        return NodeValue::fromInt(value.as<int64_t>());
+    }
+    if (value.is<double>())
+    {
+        return NodeValue::fromDouble(value.as<double>());
+    }
+    if (value.is<const char *>())
+    {
+        const char *text = value.as<const char *>();
+        const uint32_t handle = internString(text, strlen(text));
+        return handle != NO_STRING ? NodeValue::fromString(handle) : NodeValue();
+    }
+    return NodeValue();
+}
+
+template <typename Policies>
+bool NodeDecisionEngine<Policies>::valueToBool(const NodeValue &value) const
+{
+    switch (value.type)
+    {
+    case NodeValue::Bool:
+        return value.b;
+    case NodeValue::Int:
+        return value.i != 0;
+    case NodeValue::Double:
+        return value.d != 0.0; // Nonzero numbers are true
+    case NodeValue::String:
+        return internedStrings[value.s].boolValue;
+    default:
+        return false;
+    }
+}
+
+template <typename Policies>
+auto NodeDecisionEngine<Policies>::valueToNumber(const NodeValue &value) const -> Number
+{
+    switch (value.type)
+    {
+    case NodeValue::Bool:
+        return value.b ? 1.0 : 0.0;
+    case NodeValue::Int:
+        return static_cast<Number>(value.i);
+    case NodeValue::Double:
+        return value.d;
+    case NodeValue::String:
+        return internedStrings[value.s].numberValue;
+    default:
+        return 0.0;
+    }
+}
+
+// EQUAL and NOT EQUAL between two strings compare their text, which interning
+// reduces to comparing handles; any other pair of values compares as numbers
+template <typename Policies>
+bool NodeDecisionEngine<Policies>::isStringEquality(int availableId, const NodeValue &a, const NodeValue &b)
+{
+    return (availableId == NODE_KIND_EQUAL || availableId == NODE_KIND_NOT_EQUAL) &&
+           a.type == NodeValue::String && b.type == NodeValue::String;
+}
+
+template <typename Policies>
+NodeValue NodeDecisionEngine<Policies>::compareValues(int availableId, const NodeValue &a, const NodeValue &b) const
+{
+    if (isStringEquality(availableId, a, b))
+    {
+        return NodeValue::fromBool((a.s == b.s) == (availableId == NODE_KIND_EQUAL));
+    }
+    const Number inputs[NODE_KIND_MAX_ARITY] = {valueToNumber(a), valueToNumber(b)};
+    return NodeValue::fromBool(nodeKindFor<Number>(availableId).compare(inputs));
+}
+
+template <typename Policies>
+std::string NodeDecisionEngine<Policies>::valueToString(const NodeValue &value) const
+{
+    char buffer[32];
+    switch (value.type)
+    {
+    case NodeValue::Bool:
+        return value.b ? "true" : "false";
+    case NodeValue::Int:
+        snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(value.i));
+        return buffer;
+    case NodeValue::Double:
+        snprintf(buffer, sizeof(buffer), "%g", value.d);
+        return buffer;
+    case NodeValue::String:
+        return std::string(internedStrings[value.s].text.data(), internedStrings[value.s].text.size());
+    default:
+        return "null";
+    }
+}
+
+template <typename Policies>
+bool NodeDecisionEngine<Policies>::decodeLogicData(const String &jsonPayload, int deviceId)
+{
+    NDL_INFO(DECODE, "Decoding JSON...\n");
+#ifdef NDL_FIXED_CAPACITY
+    JsonDocument &doc = document;
+#else
+    DynamicJsonDocument doc(NDL_JSON_CAPACITY);
+#endif
+    DeserializationError error = deserializeJson(doc, jsonPayload.c_str(), jsonPayload.length());
+
+    if (error)
+    {
+        NDL_ERROR(DECODE, "Failed to parse JSON: %s\n", error.c_str());
+        return false;
+    }
+
+    JsonObject data = doc["data"];
+    JsonArray nodesArray = data["n"];
+    JsonArray relationshipsArray = data["r"];
+
+#if NDL_MAX_NODES_PER_DEVICE > 0
+    if (nodesArray.size() > NDL_MAX_NODES_PER_DEVICE)
+    {
+        NDL_ERROR(DECODE, "Device ID %d: %d nodes exceed the limit of %d\n",
+                          deviceId, static_cast<int>(nodesArray.size()), NDL_MAX_NODES_PER_DEVICE);
+        return false;
+    }
+#endif
+#if NDL_MAX_RELATIONSHIPS > 0
+    if (relationshipsArray.size() > NDL_MAX_RELATIONSHIPS)
+    {
+        NDL_ERROR(DECODE, "Device ID %d: %d relationships exceed the limit of %d\n",
+                          deviceId, static_cast<int>(relationshipsArray.size()), NDL_MAX_RELATIONSHIPS);
+        return false;
+    }
+#endif
+
+    // The new logic is decoded straight into its own arena, which replaces the
+    // device's current one once the plan is compiled
+    ArenaPtr arena = newDeviceArena(deviceId);
+    if (!arena)
+    {
+        return false;
+    }
+    stringsFull = false;
+    const DeviceAllocator allocator = arenaAllocator<DeviceAllocator>(arena.get());
+    Vector<NodeData> nodesForDevice(allocator);
+    nodesForDevice.reserve(nodesArray.size());
+
+    for (JsonObject node : nodesArray)
+    {
+        nodesForDevice.emplace_back();
+        NodeData &nodeData = nodesForDevice.back();
+        nodeData.id = node["id"];
+        nodeData.availableId = node["aId"];
+        nodeData.kind = internString(node["k"].as<std::string>());
+
+        const NodeKind &kind = nodeKindFor(nodeData.availableId);
+        if (kind.category == NODE_UNKNOWN)
+        {
+            NDL_WARN(DECODE, "Node ID %d has unknown availableId %d and will be ignored\n", nodeData.id, nodeData.availableId);
+        }
+        else if (node["i"].as<JsonArray>().size() < kind.arity)
+        {
+            NDL_WARN(DECODE, "Node ID %d (%s) expects %d inputs, missing ones read as false/0\n",
+                             nodeData.id, kind.name, kind.arity);
+        }
+
+        for (JsonObject input : node["i"].as<JsonArray>())
+        {
+            InputData inputData;
+            inputData.id = input["id"];
+            inputData.dataType = internString(input["dt"].as<std::string>());
+            inputData.data = valueFromJson(input["d"]);
+            nodeData.inputs.push_back(inputData);
+        }
+
+        for (JsonObject output : node["o"].as<JsonArray>())
+        {
+            OutputData outputData;
+            outputData.id = output["id"];
+            outputData.dataType = internString(output["dt"].as<std::string>());
+            outputData.deviceId = output["dId"];
+            outputData.configId = output["cId"];
+            nodeData.outputs.push_back(outputData);
+        }
+    }
+
+    SensorSet readSensors;
+    for (const auto &node : nodesForDevice)
+    {
+        if (node.availableId != 30)
+            continue;
+        for (const auto &output : node.outputs)
+        {
+            readSensors.insert(output.deviceId);
+        }
+    }
+    if (stringsFull)
+    {
+        NDL_ERROR(DECODE, "Device ID %d: logic strings do not fit the string table\n", deviceId);
+        sweepStrings();
+        return false;
+    }
+    if (!withinLimits(deviceId, readSensors))
+    {
+        sweepStrings();
+        return false;
+    }
+
+    // The current logic is set aside rather than dropped, so it can be put
+    // back if the new logic turns out not to fit its arena
+    SavedEntry<Vector<NodeData>> previousNodes;
+    SavedEntry<Vector<RelationshipData>> previousRelationships;
+    SavedEntry<CompiledPlan> previousPlans;
+    SavedEntry<DeviceProgram> previousPrograms;
+    moveEntry(deviceNodes, previousNodes, deviceId);
+    moveEntry(deviceRelationships, previousRelationships, deviceId);
+    moveEntry(devicePlans, previousPlans, deviceId);
+    moveEntry(devicePrograms, previousPrograms, deviceId);
+    const bool newDevice = deviceSlots.count(deviceId) == 0;
+
+    deviceNodes.emplace(deviceId, std::move(nodesForDevice));
+    const auto &decodedNodes = deviceNodes[deviceId];
+    // Mark which connectors named by the relationships exist; the tables are
+    // bounded by the relationship count rather than by the connector count
+    ConnectorMarks validInputIds;
+    ConnectorMarks validOutputIds;
+    for (JsonObject relationship : relationshipsArray)
+    {
+        validInputIds.emplace(relationship["i"].as<int>(), false);
+        validOutputIds.emplace(relationship["o"].as<int>(), false);
+    }
+    for (const auto &node : decodedNodes)
+    {
+        for (const auto &input : node.inputs)
+        {
+            auto mark = validInputIds.find(input.id);
+            if (mark != validInputIds.end())
+                mark->second = true;
+        }
+        for (const auto &output : node.outputs)
+        {
+            auto mark = validOutputIds.find(output.id);
+            if (mark != validOutputIds.end())
+                mark->second = true;
+        }
+    }
+
+    Vector<RelationshipData> relationshipsForDevice(allocator);
+    relationshipsForDevice.reserve(relationshipsArray.size());
+    for (JsonObject relationship : relationshipsArray)
+    {
+        RelationshipData relationshipData;
+        relationshipData.id = relationship["id"];
+        relationshipData.inputId = relationship["i"];
+        relationshipData.outputId = relationship["o"];
+        relationshipData.configId = relationship["c"];
+
+        if (validInputIds.find(relationshipData.inputId)->second &&
+            validOutputIds.find(relationshipData.outputId)->second)
+        {
+            relationshipsForDevice.push_back(relationshipData);
+        }
+        else
+        {
+            NDL_WARN(DECODE, "Invalid relationship found and removed: ID %d\n", relationshipData.id);
+        }
+    }
+    deviceRelationships.emplace(deviceId, std::move(relationshipsForDevice));
+    auto previousPlan = previousPlans.find(deviceId);
+    compilePlan(deviceId, allocator, previousPlan != previousPlans.end() ? &previousPlan->second : nullptr);
+
+    if (arena->exhausted())
+    {
+        NDL_ERROR(DECODE, "Device ID %d: logic does not fit in %d arena bytes\n", deviceId, NDL_ARENA_BYTES);
+        moveEntry(previousNodes, deviceNodes, deviceId);
+        moveEntry(previousRelationships, deviceRelationships, deviceId);
+        moveEntry(previousPlans, devicePlans, deviceId);
+        moveEntry(previousPrograms, devicePrograms, deviceId);
+        if (newDevice)
+        {
+            deviceSlots.erase(deviceId);
+            deviceStates.pop_back();
+        }
+        rebuildSensorIndex();
+        sweepStrings();
+        return false;
+    }
+    // The old logic lives in the arena about to be dropped
+    previousNodes.clear();
+    previousRelationships.clear();
+    previousPlans.clear();
+    previousPrograms.clear();
+    installArena(deviceId, std::move(arena));
+    sweepStrings();
+
+    NDL_INFO(DECODE, "JSON decoding and parsing completed successfully.\n");
+    return true;
+}
+
+// Kahn's algorithm over dense node indices. Only nodes named by a relationship
+// take part; ties go to the lowest node id, like the order of the payload ids.
+template <typename Policies>
+auto NodeDecisionEngine<Policies>::topologicalSort(int deviceId) -> Vector<int>
+{
+    auto &relationships = deviceRelationships[deviceId];
+    auto &nodes = deviceNodes[deviceId];
+
+    // Connector ids are resolved once; a repeated node id names its first node
+    Map<int, int> nodeIdToIndex;
+    Map<int, int> connectorToNode;
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        const int index = nodeIdToIndex.insert({nodes[i].id, static_cast<int>(i)}).first->second;
+        for (const auto &input : nodes[i].inputs)
+        {
+            connectorToNode[input.id] = index;
+        }
+        for (const auto &output : nodes[i].outputs)
+        {
+            connectorToNode[output.id] = index;
+        }
+    }
+
+    Vector<Vector<int>> graph(nodes.size());
+    Vector<int> inDegree(nodes.size(), -1); // -1 while no relationship names the node
+    for (const auto &relationship : relationships)
+    {
+        int inputNode = connectorToNode[relationship.inputId];
+        int outputNode = connectorToNode[relationship.outputId];
+
+        graph[outputNode].push_back(inputNode);
+        inDegree[inputNode] = std::max(inDegree[inputNode], 0) + 1;
+        inDegree[outputNode] = std::max(inDegree[outputNode], 0);
+    }
+
+    Vector<int> participants;
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        if (inDegree[i] >= 0)
+        {
+            participants.push_back(static_cast<int>(i));
+        }
+    }
+    std::sort(participants.begin(), participants.end(),
+              [&nodes](int a, int b) { return nodes[a].id < nodes[b].id; });
+
+    // The sorted order doubles as the queue of nodes whose inputs are all placed
+    Vector<int> sortedOrder;
+    sortedOrder.reserve(participants.size());
+    NDL_DEBUG(DECODE, "Finding nodes with zero in-degree...");
+    for (int nodeIndex : participants)
+    {
+        if (inDegree[nodeIndex] == 0)
+        {
+            sortedOrder.push_back(nodeIndex);
+            NDL_DEBUG(DECODE, "Node ID %d added to zero in-degree queue\n", nodes[nodeIndex].id);
+        }
+    }
+
+    NDL_DEBUG(DECODE, "Processing nodes with zero in-degree...");
+    for (size_t head = 0; head < sortedOrder.size(); head++)
+    {
+        int current = sortedOrder[head];
+        NDL_DEBUG(DECODE, "Processing Node ID %d\n", nodes[current].id);
+
+        for (int dependent : graph[current])
+        {
+            inDegree[dependent]--;
+            NDL_DEBUG(DECODE, "Decreased in-degree of Node ID %d to %d\n", nodes[dependent].id, inDegree[dependent]);
+            if (inDegree[dependent] == 0)
+            {
+                sortedOrder.push_back(dependent);
+                NDL_DEBUG(DECODE, "Node ID %d added to zero in-degree queue\n", nodes[dependent].id);
+            }
+        }
+    }
+
+    if (sortedOrder.size() != participants.size())
+    {
+        NDL_ERROR(DECODE, "Error: Graph has cycles, cannot perform topological sort.\n");
+        return {};
+    }
+
+    if (NDL_LOG_ENABLED(DEBUG, DECODE) && debugEnabled)
+    {
+        debugPrint("Topological sort completed. Sorted order:");
+        for (int nodeIndex : sortedOrder)
+        {
+            debugPrint("%d ", nodes[nodeIndex].id);
+        }
+        debugPrint("\n");
+    }
+
+    return sortedOrder;
+}
+
+template <typename Policies>
+void NodeDecisionEngine<Policies>::compilePlan(int deviceId, const DeviceAllocator &allocator, const CompiledPlan *previous)
+{
+    auto &nodes = deviceNodes[deviceId];
+    auto &relationships = deviceRelationships[deviceId];
+    CompiledPlan plan(allocator);
+
+    // Dense output slots; connector ids are not used past this point
+    Map<int, int> outputIdToSlot;
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        plan.outputSlotBase.push_back(plan.slotCount);
+        for (const auto &output : nodes[i].outputs)
+        {
+            outputIdToSlot[output.id] = plan.slotCount++;
+            plan.slotNode.push_back(static_cast<int>(i));
+        }
+    }
+    plan.outputSlotBase.push_back(plan.slotCount);
+
+    // Resolve every input to the output slot feeding it; the last relationship wins
+    Map<int, int> inputIdToSlot;
+    for (const auto &relationship : relationships)
+    {
+        auto slot = outputIdToSlot.find(relationship.outputId);
+        if (slot != outputIdToSlot.end())
+        {
+            inputIdToSlot[relationship.inputId] = slot->second;
+        }
+    }
+    plan.inputSources.resize(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        for (const auto &input : nodes[i].inputs)
+        {
+            auto slot = inputIdToSlot.find(input.id);
+            plan.inputSources[i].push_back(slot != inputIdToSlot.end() ? slot->second : -1);
+        }
+    }
+
+    plan.order = topologicalSort(deviceId);
+    plan.deviceSlot = deviceSlotFor(deviceId);
+
+    // Boolean outputs take one bit each; every other slot holds a full value
+    int valueCount = 0;
+    int bitCount = 0;
+    plan.slotIndex.assign(plan.slotCount, 0);
+    for (int slot = 0; slot < plan.slotCount; slot++)
+    {
+        bool boolean = nodeKindFor(nodes[plan.slotNode[slot]].availableId).outputType == SIGNAL_BOOLEAN;
+        plan.slotIndex[slot] = boolean ? ~bitCount++ : valueCount++;
+    }
+    plan.slotValues.assign(valueCount, NodeValue());
+    plan.slotBits.assign((bitCount + 63) / 64, 0);
+    plan.slotSensor.assign(plan.slotCount, -1);
+    plan.queued.assign(nodes.size(), false);
+    plan.finalState.assign(nodes.size(), -1);
+
+    plan.nodeCone.assign(nodes.size(), -1);
+    plan.nodeFused.assign(nodes.size(), -1);
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        if (nodeKindFor(nodes[i].availableId).category == NODE_FINAL)
+        {
+            plan.finalNodes.push_back(static_cast<int>(i));
+        }
+    }
+
+    layoutNodes(nodes, plan);
+    foldConstants(deviceId, nodes, plan);
+    mergeDuplicateNodes(nodes, plan);
+    pruneDeadNodes(nodes, plan);
+    if (compileOptions & COMPILE_MINIMIZE)
+    {
+        size_t nodesBefore = plan.order.size();
+        int prunedBefore = plan.prunedNodes;
+        minimizeGates(nodes, plan);
+        pruneDeadNodes(nodes, plan);
+        plan.minimizedNodes = static_cast<int>(nodesBefore - plan.order.size());
+        plan.prunedNodes = prunedBefore;
+    }
+    plan.graphOrder = plan.order;
+
+    if (compileOptions & (COMPILE_LOOKUP | COMPILE_BDD))
+    {
+        collapseGateCones(nodes, plan);
+    }
+    if (compileOptions & COMPILE_FUSE)
+    {
+        fuseMathChains(nodes, plan);
+    }
+    if (!plan.cones.empty() || !plan.fused.empty())
+    {
+        // Nodes left without readers now live inside a cone or a fused kernel
+        int prunedBefore = plan.prunedNodes;
+        pruneDeadNodes(nodes, plan);
+        plan.collapsedNodes = plan.prunedNodes - prunedBefore;
+        plan.prunedNodes = prunedBefore;
+    }
+    // The passes rewire inputs and rewrite kinds
+    layoutNodes(nodes, plan);
+
+    // Ranks and downstream edges used by incremental evaluation
+    plan.rank.assign(nodes.size(), -1);
+    plan.consumers.resize(nodes.size());
+    for (size_t rank = 0; rank < plan.order.size(); rank++)
+    {
+        int nodeIndex = plan.order[rank];
+        plan.rank[nodeIndex] = static_cast<int>(rank);
+        for (int source : liveSources(plan, nodeIndex))
+        {
+            if (source < 0)
+                continue;
+            auto &consumers = plan.consumers[plan.slotNode[source]];
+            if (std::find(consumers.begin(), consumers.end(), nodeIndex) == consumers.end())
+            {
+                consumers.push_back(nodeIndex);
+            }
+        }
+    }
+
+    // Logic identical to what the device already runs keeps its last sent state,
+    // so re-pushing the same rules does not re-trigger the callback
+    Vector<uint32_t> oldRoots, newRoots;
+    if (previous != nullptr && finalBddRoots(*previous, oldRoots) &&
+        finalBddRoots(plan, newRoots) && oldRoots.size() == newRoots.size())
+    {
+        bool equivalent = true;
+        for (size_t i = 0; i < oldRoots.size() && equivalent; i++)
+        {
+            equivalent = bddEquivalent(previous->bddNodes.data(), oldRoots[i], previous->bddVarKeys.data(),
+                                       plan.bddNodes.data(), newRoots[i], plan.bddVarKeys.data());
+        }
+        if (equivalent)
+        {
+            for (size_t i = 0; i < plan.finalNodes.size(); i++)
+            {
+                plan.finalState[plan.finalNodes[i]] = previous->finalState[previous->finalNodes[i]];
+            }
+            NDL_INFO(COMPILE, "Device ID %d: logic unchanged, keeping last sent state\n", deviceId);
+        }
+    }
+
+    NDL_INFO(COMPILE, "Compiled plan for Device ID %d: %d nodes, %d slots, %d folded, %d merged, %d pruned, %d minimized, %d collapsed\n",
+                      deviceId, static_cast<int>(plan.order.size()), plan.slotCount,
+                      plan.foldedNodes, plan.mergedNodes, plan.prunedNodes, plan.minimizedNodes, plan.collapsedNodes);
+    // Moved, not assigned: an assignment would copy into the entry's old arena
+    devicePlans.erase(deviceId);
+    devicePlans.emplace(deviceId, std::move(plan));
+
+    devicePrograms.erase(deviceId);
+    if (compileOptions & COMPILE_BYTECODE)
+    {
+        DeviceProgram program(allocator);
+        if (emitProgram(deviceId, program))
+        {
+            devicePrograms.emplace(deviceId, std::move(program));
+        }
+    }
+    rebuildSensorIndex();
+}
+
+// Moves the entry of deviceId, if any, from one table to the other, replacing
+// what the other held for it. Moving keeps the entry's arena allocator.
+template <typename Policies>
+template <typename From, typename To>
+void NodeDecisionEngine<Policies>::moveEntry(From &from, To &to, int deviceId)
+{
+    to.erase(deviceId);
+    auto entry = from.find(deviceId);
+    if (entry != from.end())
+    {
+        to.emplace(deviceId, std::move(entry->second));
+        from.erase(entry);
+    }
+}
+
+// Arena for new logic of the device: one from the pool under NDL_FIXED_CAPACITY,
+// otherwise one sized to hold what its current logic used in one chunk
+template <typename Policies>
+auto NodeDecisionEngine<Policies>::newDeviceArena(int deviceId) -> ArenaPtr
+{
+#ifdef NDL_FIXED_CAPACITY
+    ArenaPtr arena(arenaPool.acquire(), ArenaDeleter(this));
+    if (!arena)
+    {
+        NDL_ERROR(DECODE, "Device ID %d: no free arena\n", deviceId);
+    }
+    return arena;
+#else
+    auto current = deviceArenas.find(deviceId);
+    return ArenaPtr(new NodeArena(current != deviceArenas.end() ? current->second->bytesUsed() + 64 : 1024), ArenaDeleter(this));
+#endif
+}
+
+// Makes the arena holding the device's new graph, plan and program its own,
+// dropping the arena of its previous logic in one go
+template <typename Policies>
+void NodeDecisionEngine<Policies>::installArena(int deviceId, ArenaPtr arena)
+{
+    NDL_DEBUG(COMPILE, "Device ID %d: %d bytes in %d arena chunks\n", deviceId,
+                       static_cast<int>(arena->bytesUsed()), static_cast<int>(arena->chunkCount()));
+    deviceArenas.erase(deviceId);
+    deviceArenas.emplace(deviceId, std::move(arena));
+}
+
+template <typename Policies>
+void NodeDecisionEngine<Policies>::releaseArena(NodeArena *arena)
+{
+#ifdef NDL_FIXED_CAPACITY
+    arenaPool.release(arena);
+#else
+    delete arena;
+#endif
+}
+
+// Evaluates nodes fed only by defaults and other constants once, at decode time.
+// Their output slots then hold literals and the nodes leave the evaluation order.
+template <typename Policies>
+void NodeDecisionEngine<Policies>::foldConstants(int deviceId, Vector<NodeData> &nodes, CompiledPlan &plan)
+{
+    // Slots that can never change after decode: outputs of folded nodes, and of
+    // final or unknown nodes, which never write their outputs
+    Vector<bool> constantNode(nodes.size(), false);
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        NodeCategory category = nodeKindFor(nodes[i].availableId).category;
+        constantNode[i] = category == NODE_FINAL || category == NODE_UNKNOWN;
+    }
+
+    Vector<int> remaining;
+    for (int nodeIndex : plan.order)
+    {
+        NodeCategory category = nodeKindFor(nodes[nodeIndex].availableId).category;
+        bool foldable = category == NODE_LOGIC || category == NODE_MATH ||
+                        category == NODE_COMPARE || category == NODE_UNKNOWN;
+        for (int source : plan.inputSources[nodeIndex])
+        {
+            if (source >= 0 && !constantNode[plan.slotNode[source]])
+            {
+                foldable = false;
+                break;
+            }
+        }
+
+        if (foldable)
+        {
+            evaluateNode(deviceId, nodes, plan, nodeIndex);
+            constantNode[nodeIndex] = true;
+            plan.foldedNodes++;
+        }
+        else
+        {
+            remaining.push_back(nodeIndex);
+        }
+    }
+    plan.order = remaining;
+}
+
+// Merges structurally identical nodes so each distinct computation runs once.
+// A node's signature is its availableId plus, per input, either the live slot
+// feeding it or the literal it reads; consumers of a duplicate are rewired to
+// the first node with the same signature.
+template <typename Policies>
+void NodeDecisionEngine<Policies>::mergeDuplicateNodes(Vector<NodeData> &nodes, CompiledPlan &plan)
+{
+    Vector<bool> inOrder(nodes.size(), false);
+    for (int nodeIndex : plan.order)
+    {
+        inOrder[nodeIndex] = true;
+    }
+
+    Vector<int> slotAlias(plan.slotCount);
+    for (int slot = 0; slot < plan.slotCount; slot++)
+    {
+        slotAlias[slot] = slot;
+    }
+
+    auto appendValue = [](Vector<int64_t> &signature, const NodeValue &value)
+    {
+        int64_t payload = 0;
+        if (value.type == NodeValue::Double)
+        {
+            memcpy(&payload, &value.d, sizeof(payload));
+        }
+        else if (value.type == NodeValue::Bool)
+        {
+            payload = value.b;
+        }
+        else if (value.type == NodeValue::Int)
+        {
+            payload = value.i;
+        }
+        else if (value.type == NodeValue::String)
+        {
+            payload = value.s;
+        }
+        signature.push_back(-1 - value.type); // Tags never collide with slot indices
+        signature.push_back(payload);
+    };
+
+    Map<Vector<int64_t>, int> representatives;
+    Vector<int> remaining;
+    for (int nodeIndex : plan.order)
+    {
+        auto &node = nodes[nodeIndex];
+        auto &sources = plan.inputSources[nodeIndex];
+        for (auto &source : sources)
+        {
+            if (source >= 0)
+            {
+                source = slotAlias[source];
+            }
+        }
+
+        const NodeKind &kind = nodeKindFor(node.availableId);
+        if (kind.category == NODE_FINAL)
+        {
+            remaining.push_back(nodeIndex);
+            continue;
+        }
+
+        Vector<Vector<int64_t>> operands;
+        for (size_t i = 0; i < sources.size(); i++)
+        {
+            Vector<int64_t> operand;
+            if (sources[i] >= 0 && inOrder[plan.slotNode[sources[i]]])
+            {
+                operand.push_back(sources[i]);
+            }
+            else
+            {
+                appendValue(operand, sources[i] >= 0 ? slotValue(plan, sources[i]) : node.inputs[i].data);
+            }
+            operands.push_back(operand);
+        }
+        if (kind.commutative)
+        {
+            std::sort(operands.begin(), operands.end());
+        }
+
+        Vector<int64_t> signature;
+        signature.push_back(node.availableId);
+        signature.push_back(static_cast<int64_t>(node.outputs.size()));
+        for (const auto &output : node.outputs)
+        {
+            // Device inputs differ by the sensor they read
+            signature.push_back(kind.category == NODE_DEVICE_INPUT ? output.deviceId : 0);
+        }
+        for (const auto &operand : operands)
+        {
+            signature.insert(signature.end(), operand.begin(), operand.end());
+        }
+
+        auto existing = representatives.find(signature);
+        if (existing == representatives.end())
+        {
+            representatives[signature] = nodeIndex;
+            remaining.push_back(nodeIndex);
+            continue;
+        }
+
+        const int base = plan.outputSlotBase[nodeIndex];
+        const int representativeBase = plan.outputSlotBase[existing->second];
+        for (size_t i = 0; i < node.outputs.size(); i++)
+        {
+            slotAlias[base + i] = representativeBase + i;
+        }
+        inOrder[nodeIndex] = false;
+        plan.mergedNodes++;
+        NDL_DEBUG(COMPILE, "Node ID %d merged into Node ID %d\n", node.id, nodes[existing->second].id);
+    }
+    plan.order = remaining;
+}
+
+// Rewrites the gates of the plan into a smaller equivalent network. Gates with
+// a constant, repeated or complementary operand reduce to a constant, a wire
+// or a NOT; double negations cancel; and NOT gates are absorbed into the gate
+// they feed or read from when the kind table has the matching gate (De Morgan).
+// Bypassed gates are left for pruneDeadNodes.
+template <typename Policies>
+void NodeDecisionEngine<Policies>::minimizeGates(Vector<NodeData> &nodes, CompiledPlan &plan)
+{
+    Vector<bool> inOrder(nodes.size(), false);
+    Vector<Vector<int>> readers(nodes.size());
+    for (int nodeIndex : plan.order)
+    {
+        inOrder[nodeIndex] = true;
+        for (int source : plan.inputSources[nodeIndex])
+        {
+            if (source >= 0)
+            {
+                readers[plan.slotNode[source]].push_back(nodeIndex);
+            }
+        }
+    }
+
+    Vector<int> slotAlias(plan.slotCount);
+    for (int slot = 0; slot < plan.slotCount; slot++)
+    {
+        slotAlias[slot] = slot;
+    }
+
+    // An operand is either a live slot or a literal
+    struct Operand
+    {
+        int slot;
+        bool value;
+    };
+    auto operand = [&](int nodeIndex, size_t i)
+    {
+        Operand op = {-1, false};
+        int source = i < plan.inputSources[nodeIndex].size() ? plan.inputSources[nodeIndex][i] : -1;
+        if (source >= 0 && inOrder[plan.slotNode[source]])
+            op.slot = source;
+        else if (source >= 0)
+            op.value = slotBool(plan, source);
+        else if (i < nodes[nodeIndex].inputs.size())
+            op.value = valueToBool(nodes[nodeIndex].inputs[i].data);
+        return op;
+    };
+    auto onlyReader = [&](int nodeIndex, int reader)
+    {
+        return std::all_of(readers[nodeIndex].begin(), readers[nodeIndex].end(),
+                           [&](int other)
+                           { return other == reader; });
+    };
+    // Slot read by a NOT gate that only this node reads, -1 otherwise
+    auto negatedSlot = [&](int slot, int reader)
+    {
+        int owner = slot >= 0 ? plan.slotNode[slot] : -1;
+        if (owner < 0 || !inOrder[owner] || nodes[owner].availableId != NODE_KIND_NOT || !onlyReader(owner, reader))
+            return -1;
+        return operand(owner, 0).slot;
+    };
+    // Readers may see the slot directly if it is already boolean, or if every
+    // reader converts its inputs to boolean anyway
+    auto canBypass = [&](int nodeIndex, int slot)
+    {
+        if (nodeKindFor(nodes[plan.slotNode[slot]].availableId).outputType == SIGNAL_BOOLEAN)
+            return true;
+        return std::all_of(readers[nodeIndex].begin(), readers[nodeIndex].end(),
+                           [&](int reader)
+                           {
+                               NodeCategory category = nodeKindFor(nodes[reader].availableId).category;
+                               return category == NODE_LOGIC || category == NODE_FINAL;
+                           });
+    };
+    auto bypass = [&](int nodeIndex, int slot)
+    {
+        for (size_t i = 0; i < nodes[nodeIndex].outputs.size(); i++)
+        {
+            slotAlias[plan.outputSlotBase[nodeIndex] + i] = slot;
+        }
+        auto &target = readers[plan.slotNode[slot]];
+        target.insert(target.end(), readers[nodeIndex].begin(), readers[nodeIndex].end());
+    };
+    auto rewire = [&](int nodeIndex, size_t i, int slot)
+    {
+        plan.inputSources[nodeIndex][i] = slot;
+        if (slot >= 0)
+        {
+            readers[plan.slotNode[slot]].push_back(nodeIndex);
+        }
+    };
+
+    Vector<int> remaining;
+    for (int nodeIndex : plan.order)
+    {
+        auto &node = nodes[nodeIndex];
+        for (auto &source : plan.inputSources[nodeIndex])
+        {
+            if (source >= 0)
+            {
+                source = slotAlias[source];
+            }
+        }
+        if (nodeKindFor(node.availableId).category != NODE_LOGIC)
+        {
+            remaining.push_back(nodeIndex);
+            continue;
+        }
+
+        bool kept = true;
+        for (bool rewritten = true; rewritten && kept;)
+        {
+            rewritten = false;
+            const NodeKind &kind = nodeKindFor(node.availableId);
+            const uint8_t table = gateTruthTable(kind);
+            Operand a = operand(nodeIndex, 0);
+            Operand b = kind.arity > 1 ? operand(nodeIndex, 1) : a;
+
+            // Reduce to a function of at most one slot x: f0 and f1 are its
+            // values for x false and x true
+            int x = -1;
+            int f0 = -1, f1 = -1;
+            if (a.slot < 0 && b.slot < 0)
+            {
+                f0 = f1 = (table >> (a.value | b.value << 1)) & 1;
+            }
+            else if (a.slot < 0 || b.slot < 0 || a.slot == b.slot)
+            {
+                x = a.slot < 0 ? b.slot : a.slot;
+                int va0 = a.slot < 0 ? a.value : 0, va1 = a.slot < 0 ? a.value : 1;
+                int vb0 = b.slot < 0 ? b.value : 0, vb1 = b.slot < 0 ? b.value : 1;
+                f0 = (table >> (va0 | vb0 << 1)) & 1;
+                f1 = (table >> (va1 | vb1 << 1)) & 1;
+            }
+            else if (negatedSlot(b.slot, nodeIndex) == a.slot)
+            {
+                x = a.slot;
+                f0 = (table >> 2) & 1;
+                f1 = (table >> 1) & 1;
+            }
+            else if (negatedSlot(a.slot, nodeIndex) == b.slot)
+            {
+                x = b.slot;
+                f0 = (table >> 1) & 1;
+                f1 = (table >> 2) & 1;
+            }
+
+            if (f0 >= 0 && f0 == f1)
+            {
+                NodeValue value = NodeValue::fromBool(f0);
+                for (size_t i = 0; i < node.outputs.size(); i++)
+                {
+                    storeSlot(plan, plan.outputSlotBase[nodeIndex] + i, value);
+                }
+                inOrder[nodeIndex] = false;
+                kept = false;
+                NDL_DEBUG(COMPILE, "Node ID %d: %s is always %s\n", node.id, kind.name, f0 ? "true" : "false");
+            }
+            else if (f0 == 0 && f1 == 1 && canBypass(nodeIndex, x))
+            {
+                bypass(nodeIndex, x);
+                kept = false;
+                NDL_DEBUG(COMPILE, "Node ID %d: %s passes its input through\n", node.id, kind.name);
+            }
+            else if (f0 == 1 && f1 == 0 && !(node.availableId == NODE_KIND_NOT && a.slot == x))
+            {
+                NDL_DEBUG(COMPILE, "Node ID %d: %s reduced to NOT\n", node.id, kind.name);
+                node.availableId = NODE_KIND_NOT;
+                rewire(nodeIndex, 0, x);
+                for (size_t i = 1; i < plan.inputSources[nodeIndex].size(); i++)
+                {
+                    plan.inputSources[nodeIndex][i] = -1;
+                }
+                rewritten = true;
+            }
+            else if (kind.arity == 1)
+            {
+                // NOT over a NOT is a wire; NOT over another gate flips that gate
+                const int owner = plan.slotNode[a.slot];
+                const int inner = negatedSlot(a.slot, nodeIndex);
+                if (inner >= 0 && canBypass(nodeIndex, inner))
+                {
+                    bypass(nodeIndex, inner);
+                    kept = false;
+                    NDL_DEBUG(COMPILE, "Node ID %d: double NOT removed\n", node.id);
+                }
+                else if (nodeKindFor(nodes[owner].availableId).category == NODE_LOGIC &&
+                         nodes[owner].availableId != NODE_KIND_NOT && onlyReader(owner, nodeIndex))
+                {
+                    nodes[owner].availableId = gateWithTruthTable(~gateTruthTable(nodeKindFor(nodes[owner].availableId)) & 0xF);
+                    bypass(nodeIndex, a.slot);
+                    kept = false;
+                    NDL_DEBUG(COMPILE, "Node ID %d: NOT absorbed into Node ID %d as %s\n",
+                                       node.id, nodes[owner].id, nodeKindFor(nodes[owner].availableId).name);
+                }
+            }
+            else if (f0 < 0)
+            {
+                // Absorb NOT gates on the inputs when a gate computes the result
+                const int innerA = negatedSlot(a.slot, nodeIndex);
+                const int innerB = negatedSlot(b.slot, nodeIndex);
+                const int flips[3] = {3, 1, 2};
+                for (int flip : flips)
+                {
+                    if (((flip & 1) && innerA < 0) || ((flip & 2) && innerB < 0))
+                        continue;
+                    uint8_t flipped = 0;
+                    for (int k = 0; k < 4; k++)
+                    {
+                        flipped |= ((table >> (k ^ flip)) & 1) << k;
+                    }
+                    int availableId = gateWithTruthTable(flipped);
+                    if (availableId == 0)
+                        continue;
+                    NDL_DEBUG(COMPILE, "Node ID %d: %s with negated inputs rewritten as %s\n",
+                                       node.id, kind.name, nodeKinds[availableId].name);
+                    node.availableId = availableId;
+                    if (flip & 1)
+                        rewire(nodeIndex, 0, innerA);
+                    if (flip & 2)
+                        rewire(nodeIndex, 1, innerB);
+                    rewritten = true;
+                    break;
+                }
+            }
+        }
+
+        if (kept)
+        {
+            remaining.push_back(nodeIndex);
+        }
+        else
+        {
+            inOrder[nodeIndex] = false;
+        }
+    }
+    plan.order = remaining;
+}
+
+// Drops nodes whose outputs cannot reach any final node
+template <typename Policies>
+void NodeDecisionEngine<Policies>::pruneDeadNodes(Vector<NodeData> &nodes, CompiledPlan &plan)
+{
+    Vector<bool> live(nodes.size(), false);
+    for (auto it = plan.order.rbegin(); it != plan.order.rend(); ++it)
+    {
+        int nodeIndex = *it;
+        if (nodeKindFor(nodes[nodeIndex].availableId).category == NODE_FINAL)
+        {
+            live[nodeIndex] = true;
+        }
+        if (!live[nodeIndex])
+            continue;
+        for (int source : liveSources(plan, nodeIndex))
+        {
+            if (source >= 0)
+            {
+                live[plan.slotNode[source]] = true;
+            }
+        }
+    }
+
+    Vector<int> remaining;
+    for (int nodeIndex : plan.order)
+    {
+        if (live[nodeIndex])
+        {
+            remaining.push_back(nodeIndex);
+        }
+        else
+        {
+            plan.prunedNodes++;
+        }
+    }
+    plan.order = remaining;
+}
+
+// Replaces each maximal network of boolean gates with a single program rooted
+// at its top gate: a 64-bit truth table when it reads at most six slots, or a
+// reduced ordered BDD when COMPILE_BDD is set. Diagram variables are ordered by
+// sensor deviceId first so diagrams of different graphs are comparable. A cone
+// whose diagram would take the plan past BDD_NODE_LIMIT nodes keeps its gates.
+template <typename Policies>
+void NodeDecisionEngine<Policies>::collapseGateCones(Vector<NodeData> &nodes, CompiledPlan &plan)
+{
+    static const size_t BDD_NODE_LIMIT = NDL_BDD_NODES;
+    const bool keepDiagrams = (compileOptions & COMPILE_BDD) != 0;
+
+    Vector<bool> inOrder(nodes.size(), false);
+    for (int nodeIndex : plan.order)
+    {
+        inOrder[nodeIndex] = true;
+    }
+    auto isGate = [&](int nodeIndex)
+    { return inOrder[nodeIndex] && nodeKindFor(nodes[nodeIndex].availableId).category == NODE_LOGIC; };
+
+    // Cone roots: gates read by at least one node that is not a gate
+    Vector<int> roots;
+    Vector<bool> isRoot(nodes.size(), false);
+    for (int nodeIndex : plan.order)
+    {
+        if (isGate(nodeIndex))
+            continue;
+        for (int source : plan.inputSources[nodeIndex])
+        {
+            if (source >= 0 && isGate(plan.slotNode[source]) && !isRoot[plan.slotNode[source]])
+            {
+                isRoot[plan.slotNode[source]] = true;
+                roots.push_back(plan.slotNode[source]);
+            }
+        }
+    }
+    if (roots.empty())
+    {
+        return;
+    }
+
+    // Gates of every cone in evaluation order, and the live slots each cone reads
+    Vector<Vector<int>> coneGates(roots.size());
+    Vector<Vector<bool>> coneMembers(roots.size());
+    Vector<Map<int, int64_t>> coneLeaves(roots.size());
+    Map<int, int64_t> leafKeys;
+    for (size_t c = 0; c < roots.size(); c++)
+    {
+        auto &member = coneMembers[c];
+        member.assign(nodes.size(), false);
+        Vector<int> stack(1, roots[c]);
+        member[roots[c]] = true;
+        while (!stack.empty())
+        {
+            int nodeIndex = stack.back();
+            stack.pop_back();
+            for (int source : plan.inputSources[nodeIndex])
+            {
+                if (source < 0 || !inOrder[plan.slotNode[source]])
+                    continue;
+                int owner = plan.slotNode[source];
+                if (isGate(owner))
+                {
+                    if (!member[owner])
+                    {
+                        member[owner] = true;
+                        stack.push_back(owner);
+                    }
+                }
+                else
+                {
+                    const auto &ownerNode = nodes[owner];
+                    bool isSensor = nodeKindFor(ownerNode.availableId).category == NODE_DEVICE_INPUT;
+                    coneLeaves[c][source] = isSensor ? ownerNode.outputs[source - plan.outputSlotBase[owner]].deviceId
+                                                     : -1 - static_cast<int64_t>(source);
+                }
+            }
+        }
+        // Without diagrams, wide cones stay as individual gates
+        if (!keepDiagrams && coneLeaves[c].size() > CONE_TABLE_MAX_LEAVES)
+            continue;
+        for (int nodeIndex : plan.order)
+        {
+            if (member[nodeIndex])
+            {
+                coneGates[c].push_back(nodeIndex);
+            }
+        }
+        leafKeys.insert(coneLeaves[c].begin(), coneLeaves[c].end());
+    }
+
+    // Variable order: sensors by deviceId, then device-local slots
+    Vector<std::pair<int64_t, int>> variables;
+    for (const auto &leaf : leafKeys)
+    {
+        variables.push_back({leaf.second >= 0 ? leaf.second : INT64_MAX + leaf.second, leaf.first});
+    }
+    std::sort(variables.begin(), variables.end());
+    Map<int, uint32_t> slotVariable;
+    for (const auto &variable : variables)
+    {
+        slotVariable[variable.second] = static_cast<uint32_t>(plan.bddVarSlots.size());
+        plan.bddVarSlots.push_back(variable.second);
+        plan.bddVarKeys.push_back(leafKeys[variable.second]);
+    }
+
+    // Cones that fit a truth table are built first, so a wide cone running
+    // out of diagram nodes cannot keep them from becoming tables
+    Vector<int> buildOrder;
+    for (int narrow = 1; narrow >= 0; narrow--)
+    {
+        for (size_t c = 0; c < roots.size(); c++)
+        {
+            if (!coneGates[c].empty() && (coneLeaves[c].size() <= CONE_TABLE_MAX_LEAVES) == (narrow != 0))
+            {
+                buildOrder.push_back(static_cast<int>(c));
+            }
+        }
+    }
+
+#ifdef NDL_FIXED_CAPACITY
+    BddBuilder builder(bddPool);
+#else
+    BddBuilder builder(BDD_NODE_LIMIT);
+#endif
+    int tableCones = 0;
+    for (int c : buildOrder)
+    {
+        const size_t checkpoint = builder.size();
+        Map<int, uint32_t> gateDiagram;
+        Vector<int> leaves;
+        for (int nodeIndex : coneGates[c])
+        {
+            const auto &node = nodes[nodeIndex];
+            const NodeKind &kind = nodeKindFor(node.availableId);
+            uint32_t operands[NODE_KIND_MAX_ARITY] = {BDD_FALSE, BDD_FALSE};
+            for (size_t i = 0; i < std::min<size_t>(kind.arity, node.inputs.size()); i++)
+            {
+                int source = plan.inputSources[nodeIndex][i];
+                if (source < 0)
+                {
+                    operands[i] = builder.constant(valueToBool(node.inputs[i].data));
+                }
+                else if (!inOrder[plan.slotNode[source]])
+                {
+                    operands[i] = builder.constant(slotBool(plan, source));
+                }
+                else if (coneMembers[c][plan.slotNode[source]])
+                {
+                    operands[i] = gateDiagram[plan.slotNode[source]];
+                }
+                else
+                {
+                    operands[i] = builder.variable(slotVariable[source]);
+                    if (std::find(leaves.begin(), leaves.end(), source) == leaves.end())
+                    {
+                        leaves.push_back(source);
+                    }
+                }
+            }
+            gateDiagram[nodeIndex] = builder.apply(kind.logic, operands[0], kind.arity > 1 ? operands[1] : operands[0]);
+        }
+
+        // Only this cone stays as gates; the cones already built are kept
+        if (builder.overflowed())
+        {
+            NDL_WARN(COMPILE, "BDD exceeds %u nodes, keeping the gates of Node ID %d\n",
+                             static_cast<unsigned>(BDD_NODE_LIMIT), nodes[roots[c]].id);
+            builder.rollback(checkpoint);
+            continue;
+        }
+
+        ConeProgram cone;
+        cone.leaves = leaves;
+        cone.bddRoot = gateDiagram[roots[c]];
+        cone.lookup = leaves.size() <= CONE_TABLE_MAX_LEAVES;
+        cone.truthTable = 0;
+        if (cone.lookup)
+        {
+            // Bit k of the table is the cone's value when leaf i holds bit i of k
+            for (uint32_t k = 0; k < (1u << leaves.size()); k++)
+            {
+                bool value = bddEvaluate(builder.data(), cone.bddRoot, [&](uint32_t var)
+                                         {
+                                             size_t leaf = std::find(leaves.begin(), leaves.end(), plan.bddVarSlots[var]) - leaves.begin();
+                                             return ((k >> leaf) & 1) != 0;
+                                         });
+                cone.truthTable |= static_cast<uint64_t>(value) << k;
+            }
+            tableCones++;
+        }
+        plan.nodeCone[roots[c]] = static_cast<int>(plan.cones.size());
+        plan.cones.push_back(cone);
+    }
+
+    // Every cone is a table when diagrams are not kept
+    if (keepDiagrams)
+    {
+        plan.bddNodes.assign(builder.data(), builder.data() + builder.size());
+    }
+    else
+    {
+        plan.bddVarSlots.clear();
+        plan.bddVarKeys.clear();
+    }
+    NDL_INFO(COMPILE, "Collapsed %d gate cones, %d as truth tables, %d BDD nodes\n",
+                      static_cast<int>(plan.cones.size()), tableCones, static_cast<int>(plan.bddNodes.size()));
+}
+
+// Fuses each tree of math and comparison nodes whose results are read by
+// exactly one other math or comparison node into that reader. The reader then
+// runs the whole tree with intermediates in registers and writes only the
+// final result.
+template <typename Policies>
+void NodeDecisionEngine<Policies>::fuseMathChains(Vector<NodeData> &nodes, CompiledPlan &plan)
+{
+    Vector<bool> inOrder(nodes.size(), false);
+    Vector<Vector<int>> readers(nodes.size());
+    for (int nodeIndex : plan.order)
+    {
+        inOrder[nodeIndex] = true;
+        for (int source : liveSources(plan, nodeIndex))
+        {
+            if (source >= 0)
+            {
+                readers[plan.slotNode[source]].push_back(nodeIndex);
+            }
+        }
+    }
+    // Registers hold numbers, so equality that may see two strings stays out:
+    // device inputs can deliver strings at run time, literals are known now.
+    // Sensor slots are bound after the passes, so the source's kind decides.
+    auto mayCompareStrings = [&](int nodeIndex)
+    {
+        const auto &node = nodes[nodeIndex];
+        if (node.availableId != NODE_KIND_EQUAL && node.availableId != NODE_KIND_NOT_EQUAL)
+            return false;
+        for (size_t i = 0; i < std::min<size_t>(node.inputs.size(), NODE_KIND_MAX_ARITY); i++)
+        {
+            int source = plan.inputSources[nodeIndex][i];
+            if (source >= 0 ? nodeKindFor(nodes[plan.slotNode[source]].availableId).category == NODE_DEVICE_INPUT
+                            : node.inputs[i].data.type == NodeValue::String)
+                return true;
+        }
+        return false;
+    };
+    auto isArithmetic = [&](int nodeIndex)
+    {
+        NodeCategory category = nodeKindFor(nodes[nodeIndex].availableId).category;
+        return inOrder[nodeIndex] && plan.nodeCone[nodeIndex] < 0 && !mayCompareStrings(nodeIndex) &&
+               (category == NODE_MATH || category == NODE_COMPARE);
+    };
+    // Fused into its reader: arithmetic read exactly once, by arithmetic
+    auto isInner = [&](int nodeIndex)
+    { return isArithmetic(nodeIndex) && readers[nodeIndex].size() == 1 && isArithmetic(readers[nodeIndex][0]); };
+
+    int fusedNodes = 0;
+    for (int tail : plan.order)
+    {
+        if (!isArithmetic(tail) || isInner(tail))
+            continue;
+
+        // Members of the tree in evaluation order, ending with the tail
+        Vector<bool> member(nodes.size(), false);
+        Vector<int> stack(1, tail);
+        member[tail] = true;
+        size_t memberCount = 1;
+        while (!stack.empty())
+        {
+            int nodeIndex = stack.back();
+            stack.pop_back();
+            for (int source : plan.inputSources[nodeIndex])
+            {
+                if (source >= 0 && isInner(plan.slotNode[source]) && !member[plan.slotNode[source]])
+                {
+                    member[plan.slotNode[source]] = true;
+                    stack.push_back(plan.slotNode[source]);
+                    memberCount++;
+                }
+            }
+        }
+        if (memberCount < 2 || memberCount > FUSED_MAX_STEPS)
+            continue;
+
+        FusedProgram program;
+        Vector<int> registerOf(nodes.size(), -1);
+        for (int nodeIndex : plan.order)
+        {
+            if (!member[nodeIndex])
+                continue;
+            const auto &node = nodes[nodeIndex];
+            const Kind &kind = nodeKindFor<Number>(node.availableId);
+            FusedStep step;
+            step.math = kind.math;
+            step.compare = kind.compare;
+            for (int i = 0; i < NODE_KIND_MAX_ARITY; i++)
+            {
+                // Inputs past the node's arity or input list read as zero
+                int source = i < kind.arity && i < static_cast<int>(node.inputs.size()) ? plan.inputSources[nodeIndex][i] : -1;
+                step.operandRegister[i] = -1;
+                step.operandSlot[i] = -1;
+                step.operandValue[i] = 0.0;
+                if (source >= 0 && member[plan.slotNode[source]])
+                {
+                    step.operandRegister[i] = static_cast<int8_t>(registerOf[plan.slotNode[source]]);
+                }
+                else if (source >= 0 && inOrder[plan.slotNode[source]])
+                {
+                    step.operandSlot[i] = source;
+                    if (std::find(program.leaves.begin(), program.leaves.end(), source) == program.leaves.end())
+                    {
+                        program.leaves.push_back(source);
+                    }
+                }
+                else if (source >= 0)
+                {
+                    step.operandValue[i] = valueToNumber(slotValue(plan, source));
+                }
+                else if (i < kind.arity && i < static_cast<int>(node.inputs.size()))
+                {
+                    step.operandValue[i] = valueToNumber(node.inputs[i].data);
+                }
+            }
+            registerOf[nodeIndex] = static_cast<int>(program.steps.size());
+            program.steps.push_back(step);
+        }
+
+        plan.nodeFused[tail] = static_cast<int>(plan.fused.size());
+        plan.fused.push_back(program);
+        fusedNodes += static_cast<int>(memberCount) - 1;
+    }
+    if (!plan.fused.empty())
+    {
+        NDL_INFO(COMPILE, "Fused %d math nodes into %d kernels\n", fusedNodes, static_cast<int>(plan.fused.size()));
+    }
+}
+
+template <typename Policies>
+auto NodeDecisionEngine<Policies>::liveSources(const CompiledPlan &plan, int nodeIndex) -> const Vector<int> &
+{
+    if (plan.nodeCone[nodeIndex] >= 0)
+        return plan.cones[plan.nodeCone[nodeIndex]].leaves;
+    if (plan.nodeFused[nodeIndex] >= 0)
+        return plan.fused[plan.nodeFused[nodeIndex]].leaves;
+    return plan.inputSources[nodeIndex];
+}
+
+// Diagram roots feeding each final node, when the whole plan is gates over sensors
+template <typename Policies>
+bool NodeDecisionEngine<Policies>::finalBddRoots(const CompiledPlan &plan, Vector<uint32_t> &roots)
+{
+    roots.clear();
+    if (plan.bddNodes.empty())
+        return false;
+    for (int64_t key : plan.bddVarKeys)
+    {
+        if (key < 0)
+            return false;
+    }
+    for (int finalNode : plan.finalNodes)
+    {
+        int source = plan.inputSources[finalNode].empty() ? -1 : plan.inputSources[finalNode][0];
+        if (source < 0 || plan.nodeCone[plan.slotNode[source]] < 0)
+            return false;
+        roots.push_back(plan.cones[plan.nodeCone[plan.slotNode[source]]].bddRoot);
+    }
+    return !roots.empty();
+}
+
+template <typename Policies>
+bool NodeDecisionEngine<Policies>::isLogicEquivalent(int deviceIdA, int deviceIdB)
+{
+    auto a = devicePlans.find(deviceIdA);
+    auto b = devicePlans.find(deviceIdB);
+    Vector<uint32_t> rootsA, rootsB;
+    if (a == devicePlans.end() || b == devicePlans.end() ||
+        !finalBddRoots(a->second, rootsA) || !finalBddRoots(b->second, rootsB) || rootsA.size() != rootsB.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < rootsA.size(); i++)
+    {
+        if (!bddEquivalent(a->second.bddNodes.data(), rootsA[i], a->second.bddVarKeys.data(),
+                           b->second.bddNodes.data(), rootsB[i], b->second.bddVarKeys.data()))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Gates COMPILE_MINIMIZE removed from the device's current plan, -1 if it has none
+template <typename Policies>
+int NodeDecisionEngine<Policies>::minimizedGateCount(int deviceId) const
+{
+    auto plan = devicePlans.find(deviceId);
+    return plan != devicePlans.end() ? plan->second.minimizedNodes : -1;
+}
+
+template <typename Policies>
+void NodeDecisionEngine<Policies>::setCompileOptions(uint32_t options)
+{
+    compileOptions = options;
+}
+
+// Lowers the plan's graph order to bytecode. Slots keep their index as
+// registers and every distinct literal gets a register after them.
+template <typename Policies>
+bool NodeDecisionEngine<Policies>::emitProgram(int deviceId, DeviceProgram &program)
+{
+    auto planIt = devicePlans.find(deviceId);
+    if (planIt == devicePlans.end())
+    {
+        return false;
+    }
+    const auto &plan = planIt->second;
+    const auto &nodes = deviceNodes[deviceId];
+
+    Vector<bool> inOrder(nodes.size(), false);
+    for (int nodeIndex : plan.graphOrder)
+    {
+        inOrder[nodeIndex] = true;
+    }
+
+    program = DeviceProgram();
+    program.deviceSlot = plan.deviceSlot;
+    auto constantRegister = [&](const NodeValue &value)
+    {
+        size_t k = std::find(program.constants.begin(), program.constants.end(), value) - program.constants.begin();
+        if (k == program.constants.size())
+        {
+            program.constants.push_back(value);
+        }
+        return static_cast<int>(plan.slotCount + k);
+    };
+    // Live slots are read in place; defaults, folded slots and missing inputs become literals
+    auto operandRegister = [&](int nodeIndex, size_t i)
+    {
+        if (i >= nodes[nodeIndex].inputs.size())
+            return constantRegister(NodeValue());
+        int source = plan.inputSources[nodeIndex][i];
+        if (source < 0)
+            return constantRegister(nodes[nodeIndex].inputs[i].data);
+        if (!inOrder[plan.slotNode[source]])
+            return constantRegister(slotValue(plan, source));
+        return source;
+    };
+    auto emit = [&](Opcode opcode, int kind, int target, int a, int b, int32_t immediate)
+    {
+        Instruction instruction;
+        instruction.opcode = opcode;
+        instruction.kind = static_cast<uint8_t>(kind);
+        instruction.target = static_cast<uint16_t>(target);
+        instruction.a = static_cast<uint16_t>(a);
+        instruction.b = static_cast<uint16_t>(b);
+        instruction.immediate = immediate;
+        program.code.push_back(instruction);
+    };
+
+    for (int nodeIndex : plan.graphOrder)
+    {
+        const auto &node = nodes[nodeIndex];
+        const NodeKind &kind = nodeKindFor(node.availableId);
+        const int outputSlot = plan.outputSlotBase[nodeIndex];
+        switch (kind.category)
+        {
+        case NODE_DEVICE_INPUT:
+            for (size_t i = 0; i < node.outputs.size(); i++)
+            {
+                emit(OP_LOAD_SENSOR, 0, outputSlot + i, 0, 0, node.outputs[i].deviceId);
+            }
+            break;
+
+        case NODE_FINAL:
+            if (!node.inputs.empty())
+            {
+                emit(OP_EMIT_FINAL, 0, 0, operandRegister(nodeIndex, 0), 0, static_cast<int32_t>(program.finalIds.size()));
+                program.finalIds.push_back(node.id);
+            }
+            break;
+
+        case NODE_LOGIC:
+        case NODE_MATH:
+        case NODE_COMPARE:
+            if (!node.outputs.empty())
+            {
+                int a = operandRegister(nodeIndex, 0);
+                int b = kind.arity > 1 ? operandRegister(nodeIndex, 1) : a;
+                emit(OP_APPLY, node.availableId, outputSlot, a, b, 0);
+                for (size_t i = 1; i < node.outputs.size(); i++)
+                {
+                    emit(OP_STORE_SLOT, 0, outputSlot + i, outputSlot, 0, 0);
+                }
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    const size_t registerCount = plan.slotCount + program.constants.size();
+    if (registerCount > BYTECODE_MAX_REGISTERS)
+    {
+        NDL_WARN(COMPILE, "Device ID %d: %u registers exceed the bytecode limit\n", deviceId, static_cast<unsigned>(registerCount));
+        return false;
+    }
+
+    // Literals are reloaded on every run, ahead of the body
+    Vector<Instruction> body(program.code);
+    program.code.clear();
+    for (size_t k = 0; k < program.constants.size(); k++)
+    {
+        emit(OP_LOAD_CONST, 0, plan.slotCount + k, 0, 0, static_cast<int32_t>(k));
+    }
+    program.code.insert(program.code.end(), body.begin(), body.end());
+    program.registers.assign(registerCount, NodeValue());
+    program.finalState.assign(program.finalIds.size(), -1);
+    NDL_INFO(COMPILE, "Emitted program for Device ID %d: %d instructions, %d registers\n",
+                      deviceId, static_cast<int>(program.code.size()), static_cast<int>(registerCount));
+    return true;
+}
+
+template <typename Policies>
+void NodeDecisionEngine<Policies>::runProgram(int deviceId, DeviceProgram &program)
+{
+    NodeValue *registers = program.registers.data();
+    for (const Instruction &instruction : program.code)
+    {
+        switch (instruction.opcode)
+        {
+        case OP_LOAD_SENSOR:
+        {
+            const SensorState &sensor = sensors[instruction.a];
+            if (sensor.received)
+            {
+                registers[instruction.target] = sensor.value;
+            }
+            break;
+        }
+
+        case OP_LOAD_CONST:
+            registers[instruction.target] = program.constants[instruction.immediate];
+            break;
+
+        case OP_APPLY:
+        {
+            const Kind &kind = nodeKindFor<Number>(instruction.kind);
+            const NodeValue &a = registers[instruction.a];
+            const NodeValue &b = registers[instruction.b];
+            if (kind.category == NODE_LOGIC)
+            {
+                const bool inputs[NODE_KIND_MAX_ARITY] = {valueToBool(a), valueToBool(b)};
+                registers[instruction.target] = NodeValue::fromBool(kind.logic(inputs));
+            }
+            else if (kind.category == NODE_MATH)
+            {
+                const Number inputs[NODE_KIND_MAX_ARITY] = {valueToNumber(a), valueToNumber(b)};
+                registers[instruction.target] = NodeValue::fromDouble(kind.math(inputs));
+            }
+            else
+            {
+                registers[instruction.target] = compareValues(instruction.kind, a, b);
+            }
+            break;
+        }
+
+        case OP_STORE_SLOT:
+            registers[instruction.target] = registers[instruction.a];
+            break;
+
+        case OP_EMIT_FINAL:
+        {
+            bool value = valueToBool(registers[instruction.a]);
+            int8_t &state = program.finalState[instruction.immediate];
+            if (state != static_cast<int8_t>(value))
+            {
+                state = value;
+                NDL_DEBUG(EVAL, "Device ID: %d, Final Node ID: %d, Output: %s\n",
+                                deviceId, program.finalIds[instruction.immediate], value ? "true" : "false");
+                processDeviceChange(program.deviceSlot, value);
+            }
+            break;
+        }
+        }
+    }
+    program.needsRun = false;
+}
+
+template <typename Policies>
+bool NodeDecisionEngine<Policies>::exportProgram(int deviceId, std::vector<uint8_t> &bytes)
+{
+    DeviceProgram emitted;
+    const DeviceProgram *program = &emitted;
+    auto existing = devicePrograms.find(deviceId);
+    if (existing != devicePrograms.end())
+    {
+        program = &existing->second;
+    }
+    else if (!emitProgram(deviceId, emitted))
+    {
+        return false;
+    }
+
+    bytes.clear();
+    BytecodeWriter writer(bytes);
+    writer.raw(BYTECODE_MAGIC, sizeof(BYTECODE_MAGIC));
+    writer.u8(BYTECODE_VERSION);
+    writer.u32(static_cast<uint32_t>(program->registers.size()));
+    writer.u32(static_cast<uint32_t>(program->constants.size()));
+    writer.u32(static_cast<uint32_t>(program->code.size()));
+    writer.u32(static_cast<uint32_t>(program->finalIds.size()));
+
+    for (const NodeValue &value : program->constants)
+    {
+        writer.u8(value.type);
+        switch (value.type)
+        {
+        case NodeValue::Bool:
+            writer.u8(value.b);
+            break;
+        case NodeValue::Int:
+            writer.u64(static_cast<uint64_t>(value.i));
+            break;
+        case NodeValue::Double:
+        {
+            uint64_t bits;
+            memcpy(&bits, &value.d, sizeof(bits));
+            writer.u64(bits);
+            break;
+        }
+        case NodeValue::String:
+        {
+            const StringText &text = internedStrings[value.s].text;
+            if (text.size() > 0xFFFF)
+            {
+                NDL_WARN(COMPILE, "Device ID %d: string literal too long for bytecode\n", deviceId);
+                return false;
+            }
+            writer.u16(static_cast<uint16_t>(text.size()));
+            writer.raw(text.data(), text.size());
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    for (const Instruction &instruction : program->code)
+    {
+        writer.u8(instruction.opcode);
+        writer.u8(instruction.kind);
+        writer.u16(instruction.target);
+        writer.u16(instruction.opcode == OP_LOAD_SENSOR ? 0 : instruction.a);
+        writer.u16(instruction.b);
+        writer.u32(static_cast<uint32_t>(instruction.immediate));
+    }
+    for (int finalId : program->finalIds)
+    {
+        writer.u32(static_cast<uint32_t>(finalId));
+    }
+    writer.u32(bytecodeChecksum(bytes.data(), bytes.size()));
+    return true;
+}
+
+// Installs a serialized program in place of any logic decoded for the device.
+// The image is validated completely before anything is replaced, starting
+// with its checksum, so a damaged flash page is never parsed.
+template <typename Policies>
+bool NodeDecisionEngine<Policies>::loadProgram(int deviceId, const uint8_t *bytes, size_t size)
+{
+    const size_t checksumSize = 4;
+    if (size < sizeof(BYTECODE_MAGIC) + checksumSize)
+    {
+        NDL_ERROR(COMPILE, "Invalid program image for Device ID %d: %d bytes\n", deviceId, static_cast<int>(size));
+        return false;
+    }
+    size -= checksumSize;
+    BytecodeReader trailer(bytes + size, checksumSize);
+    if (trailer.u32() != bytecodeChecksum(bytes, size))
+    {
+        NDL_ERROR(COMPILE, "Invalid program image for Device ID %d: checksum mismatch\n", deviceId);
+        return false;
+    }
+
+    BytecodeReader reader(bytes, size);
+    uint8_t magic[sizeof(BYTECODE_MAGIC)] = {};
+    reader.raw(magic, sizeof(magic));
+    bool valid = memcmp(magic, BYTECODE_MAGIC, sizeof(magic)) == 0 && reader.u8() == BYTECODE_VERSION;
+
+    const uint32_t registerCount = reader.u32();
+    const uint32_t constantCount = reader.u32();
+    const uint32_t codeCount = reader.u32();
+    const uint32_t finalCount = reader.u32();
+    // Every entry takes at least one byte, so larger counts mean a corrupt image
+    valid = valid && reader.ok() && registerCount <= BYTECODE_MAX_REGISTERS && constantCount <= reader.remaining() &&
+            codeCount <= reader.remaining() && finalCount <= reader.remaining();
+
+    ArenaPtr arena = newDeviceArena(deviceId);
+    if (!arena)
+    {
+        return false;
+    }
+    stringsFull = false;
+    DeviceProgram program(arenaAllocator<DeviceAllocator>(arena.get()));
+    for (uint32_t k = 0; valid && k < constantCount; k++)
+    {
+        switch (reader.u8())
+        {
+        case NodeValue::Null:
+            program.constants.push_back(NodeValue());
+            break;
+        case NodeValue::Bool:
+            program.constants.push_back(NodeValue::fromBool(reader.u8() != 0));
+            break;
+        case NodeValue::Int:
+            program.constants.push_back(NodeValue::fromInt(static_cast<int64_t>(reader.u64())));
+            break;
+        case NodeValue::Double:
+        {
+            uint64_t bits = reader.u64();
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            program.constants.push_back(NodeValue::fromDouble(value));
+            break;
+        }
+        case NodeValue::String:
+        {
+            const uint16_t length = reader.u16();
+            const char *text = reinterpret_cast<const char *>(reader.view(length));
+            const uint32_t handle = text != nullptr ? internString(text, length) : NO_STRING;
+            valid = text != nullptr && handle != NO_STRING;
+            program.constants.push_back(NodeValue::fromString(handle));
+            break;
+        }
+        default:
+            valid = false;
+            break;
+        }
+    }
+
+    for (uint32_t k = 0; valid && k < codeCount; k++)
+    {
+        Instruction instruction;
+        instruction.opcode = reader.u8();
+        instruction.kind = reader.u8();
+        instruction.target = reader.u16();
+        instruction.a = reader.u16();
+        instruction.b = reader.u16();
+        instruction.immediate = static_cast<int32_t>(reader.u32());
+
+        const uint32_t immediate = static_cast<uint32_t>(instruction.immediate);
+        const NodeCategory category = nodeKindFor(instruction.kind).category;
+        valid = instruction.opcode < OP_COUNT && instruction.target < registerCount &&
+                instruction.a < registerCount && instruction.b < registerCount;
+        if (instruction.opcode == OP_LOAD_CONST)
+            valid = valid && immediate < constantCount;
+        else if (instruction.opcode == OP_APPLY)
+            valid = valid && (category == NODE_LOGIC || category == NODE_MATH || category == NODE_COMPARE);
+        else if (instruction.opcode == OP_EMIT_FINAL)
+            valid = valid && immediate < finalCount;
+        program.code.push_back(instruction);
+    }
+
+    for (uint32_t k = 0; valid && k < finalCount; k++)
+    {
+        program.finalIds.push_back(static_cast<int32_t>(reader.u32()));
+    }
+
+    if (stringsFull)
+    {
+        NDL_ERROR(COMPILE, "Device ID %d: program strings do not fit the string table\n", deviceId);
+        sweepStrings();
+        return false;
+    }
+    if (!valid || !reader.ok() || reader.remaining() != 0)
+    {
+        NDL_ERROR(COMPILE, "Invalid program image for Device ID %d\n", deviceId);
+        sweepStrings();
+        return false;
+    }
+
+    SensorSet readSensors;
+    for (const Instruction &instruction : program.code)
+    {
+        if (instruction.opcode == OP_LOAD_SENSOR)
+        {
+            readSensors.insert(instruction.immediate);
+        }
+    }
+    if (!withinLimits(deviceId, readSensors))
+    {
+        sweepStrings();
+        return false;
+    }
+
+    program.registers.assign(registerCount, NodeValue());
+    program.finalState.assign(finalCount, -1);
+    if (arena->exhausted())
+    {
+        NDL_ERROR(COMPILE, "Device ID %d: program does not fit in %d arena bytes\n", deviceId, NDL_ARENA_BYTES);
+        sweepStrings();
+        return false;
+    }
+    program.deviceSlot = deviceSlotFor(deviceId);
+    deviceNodes.erase(deviceId);
+    deviceRelationships.erase(deviceId);
+    devicePlans.erase(deviceId);
+    devicePrograms.erase(deviceId);
+    devicePrograms.emplace(deviceId, std::move(program));
+    installArena(deviceId, std::move(arena));
+    rebuildSensorIndex();
+    sweepStrings();
+    NDL_INFO(COMPILE, "Loaded program for Device ID %d: %d instructions\n", deviceId, static_cast<int>(codeCount));
+    return true;
+}
+
+// Checks that new logic for deviceId, reading the given sensors, keeps the
+// engine within the capacity limits of the build
+template <typename Policies>
+bool NodeDecisionEngine<Policies>::withinLimits(int deviceId, const SensorSet &newSensors)
+{
+#if NDL_MAX_DEVICES > 0
+    if (deviceArenas.count(deviceId) == 0 && deviceArenas.size() >= NDL_MAX_DEVICES)
+    {
+        NDL_ERROR(DECODE, "Device ID %d: already holding logic for the maximum of %d devices\n", deviceId, NDL_MAX_DEVICES);
+        return false;
+    }
+#endif
+#if NDL_MAX_SENSORS > 0
+    // Sensors read by other devices stay, the ones read by this device's old logic go
+    SensorSet readSensors(newSensors);
+    for (const SensorState &sensor : sensors)
+    {
+        for (const auto &reader : sensor.readers)
+        {
+            if (deviceStates[reader.deviceSlot].deviceId != deviceId)
+            {
+                readSensors.insert(sensor.deviceId);
+                break;
+            }
+        }
+        for (int reader : sensor.programs)
+        {
+            if (deviceStates[reader].deviceId != deviceId)
+            {
+                readSensors.insert(sensor.deviceId);
+                break;
+            }
+        }
+    }
+    if (readSensors.size() > NDL_MAX_SENSORS)
+    {
+        NDL_ERROR(DECODE, "Device ID %d: logic would read %d sensors, the limit is %d\n",
+                          deviceId, static_cast<int>(readSensors.size()), NDL_MAX_SENSORS);
+        return false;
+    }
+#endif
+    (void)deviceId;
+    (void)newSensors;
+    return true;
+}
+
+// Slot of a sensor, given one on first use. Once the table holds NDL_MAX_SENSORS
+// sensors, a new one takes over the slot of a sensor no logic reads; -1 if none.
+template <typename Policies>
+int NodeDecisionEngine<Policies>::sensorSlotFor(int deviceId)
+{
+    auto existing = sensorSlots.find(deviceId);
+    if (existing != sensorSlots.end())
+    {
+        return existing->second;
+    }
+#if NDL_MAX_SENSORS > 0
+    if (sensors.size() >= NDL_MAX_SENSORS)
+    {
+        for (size_t slot = 0; slot < sensors.size(); slot++)
+        {
+            SensorState &sensor = sensors[slot];
+            if (sensor.readers.empty() && sensor.programs.empty())
+            {
+                sensorSlots.erase(sensor.deviceId);
+                sensorSlots[deviceId] = static_cast<int>(slot);
+                sensor.deviceId = deviceId;
+                setSensorValue(sensor, NodeValue());
+                sensor.received = false;
+                return static_cast<int>(slot);
+            }
+        }
+        return -1;
+    }
+#endif
+    const int slot = static_cast<int>(sensors.size());
+    sensorSlots[deviceId] = slot;
+    sensors.push_back(SensorState());
+    sensors.back().deviceId = deviceId;
+    return slot;
+}
+
+// Slot of a device with logic; slots are never reused, so debounce state
+// survives new logic for the same device
+template <typename Policies>
+int NodeDecisionEngine<Policies>::deviceSlotFor(int deviceId)
+{
+    auto existing = deviceSlots.find(deviceId);
+    if (existing != deviceSlots.end())
+    {
+        return existing->second;
+    }
+    const int slot = static_cast<int>(deviceStates.size());
+    deviceSlots[deviceId] = slot;
+    deviceStates.push_back(DeviceState());
+    deviceStates.back().deviceId = deviceId;
+    return slot;
+}
+
+// Resolves the sensors read by every plan and program to slots, and records
+// who reads each one
+template <typename Policies>
+void NodeDecisionEngine<Policies>::rebuildSensorIndex()
+{
+    for (SensorState &sensor : sensors)
+    {
+        sensor.readers.clear();
+        sensor.programs.clear();
+    }
+
+    // Sensors that already hold a slot are registered first, so that slots
+    // taken over by new sensors only come from sensors nothing reads
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (auto &entry : devicePrograms)
+        {
+            DeviceProgram &program = entry.second;
+            for (Instruction &instruction : program.code)
+            {
+                if (instruction.opcode != OP_LOAD_SENSOR || (pass == 0) != (sensorSlots.count(instruction.immediate) > 0))
+                    continue;
+                const int slot = sensorSlotFor(instruction.immediate);
+                if (slot < 0)
+                    continue; // Ruled out by withinLimits
+                instruction.a = static_cast<uint16_t>(slot);
+                auto &programs = sensors[slot].programs;
+                if (programs.empty() || programs.back() != program.deviceSlot)
+                {
+                    programs.push_back(program.deviceSlot);
+                }
+            }
+        }
+        for (auto &entry : devicePlans)
+        {
+            CompiledPlan &plan = entry.second;
+            const auto &nodes = deviceNodes[entry.first];
+            const bool hasProgram = devicePrograms.count(entry.first) > 0;
+            for (size_t nodeIndex = 0; nodeIndex < nodes.size(); nodeIndex++)
+            {
+                if (nodes[nodeIndex].availableId != 30)
+                    continue;
+                for (size_t i = 0; i < nodes[nodeIndex].outputs.size(); i++)
+                {
+                    const int sensorId = nodes[nodeIndex].outputs[i].deviceId;
+                    if ((pass == 0) != (sensorSlots.count(sensorId) > 0))
+                        continue;
+                    // Nodes outside the order are never evaluated and do not hold a slot
+                    const bool live = plan.rank[nodeIndex] >= 0;
+                    const int slot = live || pass == 0 ? sensorSlotFor(sensorId) : -1;
+                    plan.slotSensor[plan.outputSlotBase[nodeIndex] + i] = slot;
+                    if (live && !hasProgram && slot >= 0)
+                    {
+                        sensors[slot].readers.push_back({plan.deviceSlot, static_cast<int>(nodeIndex)});
+                    }
+                }
+            }
+        }
+    }
+
+    // Size the update scratch now, so updates do not allocate
+    size_t largestPlan = 0;
+    for (const auto &entry : devicePlans)
+    {
+        largestPlan = std::max(largestPlan, entry.second.order.size());
+    }
+    readyNodes.reserve(largestPlan);
+    Vector<size_t> readerCounts(deviceStates.size(), 0);
+    for (const SensorState &sensor : sensors)
+    {
+        for (const auto &reader : sensor.readers)
+        {
+            readerCounts[reader.deviceSlot]++;
+        }
+    }
+    for (size_t slot = 0; slot < deviceStates.size(); slot++)
+    {
+        deviceStates[slot].dirtyNodes.clear();
+        deviceStates[slot].dirtyNodes.reserve(readerCounts[slot]);
+    }
+}
+
+template <typename Policies>
+void NodeDecisionEngine<Policies>::evaluatePlan(int deviceId)
+{
+    auto &nodes = deviceNodes[deviceId];
+    auto &plan = devicePlans[deviceId];
+
+    // Single pass in topological order: every upstream slot is already up to date
+    for (int nodeIndex : plan.order)
+    {
+        evaluateNode(deviceId, nodes, plan, nodeIndex);
+    }
+    plan.needsFullEvaluation = false;
+}
+
+template <typename Policies>
+void NodeDecisionEngine<Policies>::evaluateDirty(int deviceId, const Vector<int> &dirtyNodes)
+{
+    auto &nodes = deviceNodes[deviceId];
+    auto &plan = devicePlans[deviceId];
+
+    // Evaluate only the downstream cone of the dirty nodes, lowest rank first.
+    // The heap of ranks keeps its storage between updates.
+    Vector<int> &ready = readyNodes;
+    ready.clear();
+    for (int nodeIndex : dirtyNodes)
+    {
+        if (!plan.queued[nodeIndex])
+        {
+            plan.queued[nodeIndex] = true;
+            ready.push_back(plan.rank[nodeIndex]);
+            std::push_heap(ready.begin(), ready.end(), std::greater<int>());
+        }
+    }
+
+    int evaluated = 0;
+    while (!ready.empty())
+    {
+        std::pop_heap(ready.begin(), ready.end(), std::greater<int>());
+        int nodeIndex = plan.order[ready.back()];
+        ready.pop_back();
+        plan.queued[nodeIndex] = false;
+        evaluated++;
+
+        // Early cutoff: an unchanged output cannot change anything downstream
+        if (!evaluateNode(deviceId, nodes, plan, nodeIndex))
+        {
+            continue;
+        }
+
+        for (int consumer : plan.consumers[nodeIndex])
+        {
+            if (!plan.queued[consumer])
+            {
+                plan.queued[consumer] = true;
+                ready.push_back(plan.rank[consumer]);
+                std::push_heap(ready.begin(), ready.end(), std::greater<int>());
+            }
+        }
+    }
+    NDL_DEBUG(EVAL, "Device ID: %d, evaluated %d of %d nodes\n", deviceId, evaluated, static_cast<int>(plan.order.size()));
+}
+
+// Copies the evaluation fields of every node into the plan's flat arrays, so
+// evaluation never touches the decoded NodeData
+template <typename Policies>
+void NodeDecisionEngine<Policies>::layoutNodes(const Vector<NodeData> &nodes, CompiledPlan &plan)
+{
+    size_t inputCount = 0;
+    for (const auto &node : nodes)
+    {
+        inputCount += node.inputs.size();
+    }
+    plan.nodeKind.assign(nodes.size(), 0);
+    plan.inputBase.assign(nodes.size() + 1, 0);
+    plan.inputSlot.clear();
+    plan.inputSlot.reserve(inputCount);
+    plan.inputValue.clear();
+    plan.inputValue.reserve(inputCount);
+    for (size_t nodeIndex = 0; nodeIndex < nodes.size(); nodeIndex++)
+    {
+        const auto &node = nodes[nodeIndex];
+        if (node.availableId > 0 && node.availableId < NODE_KIND_COUNT)
+        {
+            plan.nodeKind[nodeIndex] = static_cast<uint8_t>(node.availableId);
+        }
+        plan.inputBase[nodeIndex] = static_cast<int>(plan.inputSlot.size());
+        for (size_t i = 0; i < node.inputs.size(); i++)
+        {
+            plan.inputSlot.push_back(plan.inputSources[nodeIndex][i]);
+            plan.inputValue.push_back(node.inputs[i].data);
+        }
+    }
+    plan.inputBase[nodes.size()] = static_cast<int>(plan.inputSlot.size());
+}
+
+// Writes a node result to all of its outputs; returns true if any slot changed
+template <typename Policies>
+bool NodeDecisionEngine<Policies>::storeResult(CompiledPlan &plan, int nodeIndex, const NodeValue &result)
+{
+    bool changed = false;
+    for (int slot = plan.outputSlotBase[nodeIndex]; slot < plan.outputSlotBase[nodeIndex + 1]; slot++)
+    {
+        changed |= storeSlot(plan, slot, result);
+    }
+    return changed;
+}
+
+template <typename Policies>
+NodeValue NodeDecisionEngine<Policies>::slotValue(const CompiledPlan &plan, int slot) const
+{
+    const int index = plan.slotIndex[slot];
+    return index >= 0 ? plan.slotValues[index] : NodeValue::fromBool((plan.slotBits[~index >> 6] >> (~index & 63)) & 1);
+}
+
+template <typename Policies>
+bool NodeDecisionEngine<Policies>::slotBool(const CompiledPlan &plan, int slot) const
+{
+    const int index = plan.slotIndex[slot];
+    return index >= 0 ? valueToBool(plan.slotValues[index]) : (plan.slotBits[~index >> 6] >> (~index & 63)) & 1;
+}
+
+// Writes one slot; returns true if its value changed
+template <typename Policies>
+bool NodeDecisionEngine<Policies>::storeSlot(CompiledPlan &plan, int slot, const NodeValue &value)
+{
+    const int index = plan.slotIndex[slot];
+    if (index >= 0)
+    {
+        bool changed = plan.slotValues[index] != value;
+        plan.slotValues[index] = value;
+        return changed;
+    }
+    const uint64_t mask = 1ULL << (~index & 63);
+    uint64_t &word = plan.slotBits[~index >> 6];
+    const uint64_t updated = valueToBool(value) ? word | mask : word & ~mask;
+    bool changed = updated != word;
+    word = updated;
+    return changed;
+}
+
+// Returns true when any output slot of the node changed value. Reads only the
+// plan's flat arrays; nodes is used for debug output.
+template <typename Policies>
+bool NodeDecisionEngine<Policies>::evaluateNode(int deviceId, Vector<NodeData> &nodes, CompiledPlan &plan, int nodeIndex)
+{
+    const int outputSlot = plan.outputSlotBase[nodeIndex];
+    const int outputCount = plan.outputSlotBase[nodeIndex + 1] - outputSlot;
+    bool changed = false;
+
+    // Collapsed cone: the whole gate network is one table lookup or one
+    // diagram walk over its leaf slots
+    if (plan.nodeCone[nodeIndex] >= 0)
+    {
+        const ConeProgram &cone = plan.cones[plan.nodeCone[nodeIndex]];
+        bool value;
+        if (cone.lookup)
+        {
+            uint32_t index = 0;
+            for (size_t i = 0; i < cone.leaves.size(); i++)
+            {
+                index |= static_cast<uint32_t>(slotBool(plan, cone.leaves[i])) << i;
+            }
+            value = (cone.truthTable >> index) & 1;
+        }
+        else
+        {
+            value = bddEvaluate(plan.bddNodes.data(), cone.bddRoot, [&](uint32_t var)
+                                { return slotBool(plan, plan.bddVarSlots[var]); });
+        }
+        return storeResult(plan, nodeIndex, NodeValue::fromBool(value));
+    }
+
+    // Fused math tree: intermediates stay in registers, only the tail is stored
+    if (plan.nodeFused[nodeIndex] >= 0)
+    {
+        const FusedProgram &program = plan.fused[plan.nodeFused[nodeIndex]];
+        Number registers[FUSED_MAX_STEPS];
+        for (size_t s = 0; s < program.steps.size(); s++)
+        {
+            const FusedStep &step = program.steps[s];
+            Number inputs[NODE_KIND_MAX_ARITY];
+            for (int i = 0; i < NODE_KIND_MAX_ARITY; i++)
+            {
+                inputs[i] = step.operandRegister[i] >= 0 ? registers[step.operandRegister[i]]
+                            : step.operandSlot[i] >= 0   ? valueToNumber(slotValue(plan, step.operandSlot[i]))
+                                                         : step.operandValue[i];
+            }
+            registers[s] = step.math ? step.math(inputs) : (step.compare(inputs) ? 1.0 : 0.0);
+        }
+        const FusedStep &last = program.steps.back();
+        Number value = registers[program.steps.size() - 1];
+        return storeResult(plan, nodeIndex, last.math ? NodeValue::fromDouble(value) : NodeValue::fromBool(value != 0.0));
+    }
+
+    const int inputBase = plan.inputBase[nodeIndex];
+    const int inputCount = plan.inputBase[nodeIndex + 1] - inputBase;
+    const int *inputSlots = plan.inputSlot.data() + inputBase;
+    NodeValue *inputValues = plan.inputValue.data() + inputBase;
+    const Kind &kind = nodeKindFor<Number>(plan.nodeKind[nodeIndex]);
+    if (kind.category != NODE_LOGIC)
+    {
+        for (int i = 0; i < inputCount; i++)
+        {
+            // Inputs without a relationship keep their default value
+            if (inputSlots[i] >= 0)
+            {
+                inputValues[i] = slotValue(plan, inputSlots[i]);
+            }
+        }
+    }
+
+    const int arity = std::min<int>(kind.arity, inputCount);
+    NodeValue result;
+
+    switch (kind.category)
+    {
+    // Handle direct device values
+    case NODE_DEVICE_INPUT:
+        for (int slot = outputSlot; slot < outputSlot + outputCount; slot++)
+        {
+            const int sensorSlot = plan.slotSensor[slot];
+            if (sensorSlot >= 0 && sensors[sensorSlot].received)
+            {
+                changed |= storeSlot(plan, slot, sensors[sensorSlot].value);
+            }
+        }
+        break;
+
+    // Handle Final Node
+    case NODE_FINAL:
+        if (inputCount > 0)
+        {
+            bool booleanValue = valueToBool(inputValues[0]);
+            NDL_DEBUG(EVAL, "Device ID: %d, Final Node ID: %d, Output: %s\n",
+                            deviceId, nodes[nodeIndex].id, booleanValue ? "true" : "false");
+            if (plan.finalState[nodeIndex] != static_cast<int8_t>(booleanValue))
+            {
+                plan.finalState[nodeIndex] = booleanValue;
+                processDeviceChange(plan.deviceSlot, booleanValue);
+                changed = true;
+            }
+        }
+        break;
+
+    // Boolean Logic Nodes: gate inputs are read straight from the bits
+    case NODE_LOGIC:
+    {
+        bool inputs[NODE_KIND_MAX_ARITY] = {};
+        for (int i = 0; i < arity; i++)
+        {
+            inputs[i] = inputSlots[i] >= 0 ? slotBool(plan, inputSlots[i]) : valueToBool(inputValues[i]);
+        }
+        result = NodeValue::fromBool(kind.logic(inputs));
+        break;
+    }
+
+    // Math Nodes
+    case NODE_MATH:
+    {
+        Number inputs[NODE_KIND_MAX_ARITY] = {};
+        for (int i = 0; i < arity; i++)
+        {
+            inputs[i] = valueToNumber(inputValues[i]);
+        }
+        result = NodeValue::fromDouble(kind.math(inputs));
+        break;
+    }
+
+    // Comparison Nodes: missing inputs read as zero
+    case NODE_COMPARE:
+        result = compareValues(plan.nodeKind[nodeIndex], arity > 0 ? inputValues[0] : NodeValue(),
+                               arity > 1 ? inputValues[1] : NodeValue());
+        break;
+
+    default:
+        break;
+    }
+
+    if (result.type != NodeValue::Null)
+    {
+        changed |= storeResult(plan, nodeIndex, result);
+    }
+
+    if (NDL_LOG_ENABLED(DEBUG, EVAL) && debugEnabled)
+    {
+        debugPrint("Node ID: %d, Inputs: ", nodes[nodeIndex].id);
+        for (int i = 0; i < inputCount; i++)
+        {
+            debugPrint("%s ", valueToString(inputSlots[i] >= 0 ? slotValue(plan, inputSlots[i]) : inputValues[i]).c_str());
+        }
+        debugPrint(", Outputs: ");
+        for (int slot = outputSlot; slot < outputSlot + outputCount; slot++)
+        {
+            debugPrint("%s ", valueToString(slotValue(plan, slot)).c_str());
+        }
+        debugPrint("\n");
+    }
+    return changed;
+}
+
+// Evaluates a boolean-only device graph for 64 independent scenarios at once.
+// Bit k of a sensor's word is that sensor's value in scenario k; sensors that
+// are not listed keep their current value in every scenario. Results are keyed
+// by final node id. Returns false when the graph has non-boolean nodes.
+template <typename Policies>
+bool NodeDecisionEngine<Policies>::evaluateBitParallel(int deviceId, const std::map<int, uint64_t> &sensorLanes,
+                                              std::map<int, uint64_t> &finalLanes)
+{
+    auto nodesIt = deviceNodes.find(deviceId);
+    auto planIt = devicePlans.find(deviceId);
+    if (nodesIt == deviceNodes.end() || planIt == devicePlans.end())
+    {
+        return false;
+    }
+    auto &nodes = nodesIt->second;
+    auto &plan = planIt->second;
+
+    for (int nodeIndex : plan.graphOrder)
+    {
+        NodeCategory category = nodeKindFor(nodes[nodeIndex].availableId).category;
+        if (category != NODE_LOGIC && category != NODE_FINAL && category != NODE_DEVICE_INPUT)
+        {
+            NDL_WARN(EVAL, "Device ID %d: Node ID %d is not boolean, bit-parallel evaluation unavailable\n",
+                           deviceId, nodes[nodeIndex].id);
+            return false;
+        }
+    }
+
+    auto broadcast = [this](const NodeValue &value) -> uint64_t
+    { return valueToBool(value) ? ~0ULL : 0ULL; };
+
+    // Slots outside the order are constants; live slots are overwritten below
+    Vector<uint64_t> lanes(plan.slotCount);
+    for (int slot = 0; slot < plan.slotCount; slot++)
+    {
+        lanes[slot] = slotBool(plan, slot) ? ~0ULL : 0ULL;
+    }
+
+    finalLanes.clear();
+    for (int nodeIndex : plan.graphOrder)
+    {
+        const NodeKind &kind = nodeKindFor(plan.nodeKind[nodeIndex]);
+        const int outputSlot = plan.outputSlotBase[nodeIndex];
+        const int outputCount = plan.outputSlotBase[nodeIndex + 1] - outputSlot;
+
+        if (kind.category == NODE_DEVICE_INPUT)
+        {
+            const auto &node = nodes[nodeIndex];
+            for (size_t i = 0; i < node.outputs.size(); i++)
+            {
+                auto sensor = sensorLanes.find(node.outputs[i].deviceId);
+                if (sensor != sensorLanes.end())
+                {
+                    lanes[outputSlot + i] = sensor->second;
+                }
+                else
+                {
+                    const int sensorSlot = plan.slotSensor[outputSlot + i];
+                    lanes[outputSlot + i] = sensorSlot >= 0 && sensors[sensorSlot].received ? broadcast(sensors[sensorSlot].value) : 0;
+                }
+            }
+            continue;
+        }
+
+        const int inputBase = plan.inputBase[nodeIndex];
+        const int arity = std::min<int>(kind.arity, plan.inputBase[nodeIndex + 1] - inputBase);
+        uint64_t inputs[NODE_KIND_MAX_ARITY] = {};
+        for (int i = 0; i < arity; i++)
+        {
+            const int source = plan.inputSlot[inputBase + i];
+            inputs[i] = source >= 0 ? lanes[source] : broadcast(plan.inputValue[inputBase + i]);
+        }
+
+        uint64_t result = kind.lanes(inputs);
+        if (kind.category == NODE_FINAL)
+        {
+            finalLanes[nodes[nodeIndex].id] = result;
+            continue;
+        }
+        for (int i = 0; i < outputCount; i++)
+        {
+            lanes[outputSlot + i] = result;
+        }
+    }
+    return true;
+}
+
+// Evaluates a device graph over columns of recorded sensor samples (one column
+// per sensor, all the same length, booleans as 0/1). Sensors without a column
+// keep their current value. Each node runs its column kernel over blocks of
+// samples; results are one 0/1 column per final node id.
+template <typename Policies>
+bool NodeDecisionEngine<Policies>::evaluateBatch(int deviceId, const std::map<int, std::vector<double>> &sensorColumns,
+                                        std::map<int, std::vector<double>> &finalColumns)
+{
+    auto nodesIt = deviceNodes.find(deviceId);
+    auto planIt = devicePlans.find(deviceId);
+    if (nodesIt == deviceNodes.end() || planIt == devicePlans.end())
+    {
+        return false;
+    }
+    auto &nodes = nodesIt->second;
+    auto &plan = planIt->second;
+
+    const size_t samples = sensorColumns.empty() ? 0 : sensorColumns.begin()->second.size();
+    for (const auto &column : sensorColumns)
+    {
+        if (column.second.size() != samples)
+        {
+            NDL_ERROR(EVAL, "Batch columns must all have %u samples\n", static_cast<unsigned>(samples));
+            return false;
+        }
+    }
+
+    static const size_t BLOCK = 256;
+
+    // Where each slot's samples come from: a computed block, a sensor column
+    // (advanced per block), or nothing yet (a constant resolved per input)
+    struct Operand
+    {
+        const double *base;
+        bool advances;
+    };
+    Vector<double> slotBlocks(static_cast<size_t>(plan.slotCount) * BLOCK);
+    Vector<Operand> slotOperands(plan.slotCount, Operand{nullptr, false});
+    Vector<Vector<double>> constantBlocks;
+
+    finalColumns.clear();
+    for (int nodeIndex : plan.graphOrder)
+    {
+        const auto &node = nodes[nodeIndex];
+        const NodeKind &kind = nodeKindFor(node.availableId);
+        const int outputSlot = plan.outputSlotBase[nodeIndex];
+
+        for (size_t i = 0; i < node.outputs.size(); i++)
+        {
+            if (kind.category != NODE_DEVICE_INPUT)
+            {
+                slotOperands[outputSlot + i] = Operand{&slotBlocks[static_cast<size_t>(outputSlot) * BLOCK], false};
+                continue;
+            }
+            auto column = sensorColumns.find(node.outputs[i].deviceId);
+            if (column != sensorColumns.end())
+            {
+                slotOperands[outputSlot + i] = Operand{column->second.data(), true};
+            }
+        }
+        if (kind.category == NODE_FINAL)
+        {
+            finalColumns[node.id].assign(samples, 0.0);
+        }
+    }
+
+    // Resolve every input of every evaluated node once
+    Vector<Vector<Operand>> nodeOperands(nodes.size());
+    for (int nodeIndex : plan.graphOrder)
+    {
+        const auto &node = nodes[nodeIndex];
+        const NodeKind &kind = nodeKindFor(node.availableId);
+        if (kind.category == NODE_DEVICE_INPUT)
+            continue;
+
+        const size_t inputCount = std::min<size_t>(kind.arity, node.inputs.size());
+        NodeValue values[NODE_KIND_MAX_ARITY];
+        bool constant[NODE_KIND_MAX_ARITY] = {};
+        for (size_t i = 0; i < inputCount; i++)
+        {
+            int source = plan.inputSources[nodeIndex][i];
+            if (source >= 0 && slotOperands[source].base != nullptr)
+                continue;
+
+            // Constant for the whole batch: a default, a folded slot or a sensor without a column
+            constant[i] = true;
+            values[i] = node.inputs[i].data;
+            if (source >= 0)
+            {
+                values[i] = slotValue(plan, source);
+                const int sensorSlot = plan.slotSensor[source];
+                if (sensorSlot >= 0)
+                {
+                    values[i] = sensors[sensorSlot].received ? sensors[sensorSlot].value : NodeValue();
+                }
+            }
+        }
+        // Columns are numbers; two constant strings compare by handle instead
+        const bool byHandle = inputCount == 2 && constant[0] && constant[1] &&
+                              isStringEquality(node.availableId, values[0], values[1]);
+        for (size_t i = 0; i < inputCount; i++)
+        {
+            if (!constant[i])
+            {
+                nodeOperands[nodeIndex].push_back(slotOperands[plan.inputSources[nodeIndex][i]]);
+                continue;
+            }
+            double value = byHandle ? static_cast<double>(values[i].s)
+                           : kind.category == NODE_LOGIC || kind.category == NODE_FINAL
+                               ? (valueToBool(values[i]) ? 1.0 : 0.0)
+                               : valueToNumber(values[i]);
+            constantBlocks.push_back(Vector<double>(BLOCK, value));
+            nodeOperands[nodeIndex].push_back(Operand{constantBlocks.back().data(), false});
+        }
+        while (nodeOperands[nodeIndex].size() < kind.arity)
+        {
+            constantBlocks.push_back(Vector<double>(BLOCK, 0.0));
+            nodeOperands[nodeIndex].push_back(Operand{constantBlocks.back().data(), false});
+        }
+    }
+
+    const double *inputs[NODE_KIND_MAX_ARITY];
+    for (size_t offset = 0; offset < samples; offset += BLOCK)
+    {
+        const size_t count = std::min(BLOCK, samples - offset);
+        for (int nodeIndex : plan.graphOrder)
+        {
+            const NodeKind &kind = nodeKindFor(plan.nodeKind[nodeIndex]);
+            if (kind.column == nullptr)
+                continue;
+
+            const auto &operands = nodeOperands[nodeIndex];
+            for (size_t i = 0; i < operands.size(); i++)
+            {
+                inputs[i] = operands[i].base + (operands[i].advances ? offset : 0);
+            }
+
+            if (kind.category == NODE_FINAL)
+            {
+                kind.column(inputs, finalColumns[nodes[nodeIndex].id].data() + offset, count);
+            }
+            else if (plan.outputSlotBase[nodeIndex + 1] > plan.outputSlotBase[nodeIndex])
+            {
+                kind.column(inputs, &slotBlocks[static_cast<size_t>(plan.outputSlotBase[nodeIndex]) * BLOCK], count);
+            }
+        }
+    }
+    return true;
+}
+
+template <typename Policies>
+bool NodeDecisionEngine<Policies>::convertToBool(const std::string &value)
+{
+    return textToBool(value.c_str(), value.size());
+}
+
+// convertToBool without copying the text, which must be null terminated
+template <typename Policies>
+bool NodeDecisionEngine<Policies>::textToBool(const char *text, size_t length)
+{
+    // Trim leading and trailing spaces
+    const char *spaces = " \t\n\r";
+    while (length > 0 && strchr(spaces, *text) != nullptr && *text != '\0')
+    {
+        text++;
+        length--;
+    }
+    while (length > 0 && strchr(spaces, text[length - 1]) != nullptr && text[length - 1] != '\0')
+    {
+        length--;
+    }
+
+    // Handle string values explicitly, ignoring case
+    auto is = [&](const char *word)
+    {
+        size_t k = 0;
+        while (k < length && word[k] != '\0' && tolower(static_cast<unsigned char>(text[k])) == word[k])
+        {
+            k++;
+        }
+        return k == length && word[k] == '\0';
+    };
+    if (is("true") || is("1") || is("yes") || is("on"))
+    {
+        return true;
+    }
+    if (is("false") || is("0") || is("no") || is("off"))
+    {
+        return false;
+    }
+
+    // Try converting numeric values; text that is not a number, or whose
+    // value is out of range, is false
+    char *end = nullptr;
+    errno = 0;
+    double numericValue = strtod(text, &end);
+    if (end == text || errno == ERANGE)
+    {
+        return false;
+    }
+    return numericValue != 0.0; // Any non-zero value is true
+}
+
+template <typename Policies>
+void NodeDecisionEngine<Policies>::processPendingChanges()
+{
+    unsigned long currentTime = Clock::now();
+    for (size_t slot = 0; slot < deviceStates.size(); slot++)
+    {
+        DeviceState &state = deviceStates[slot];
+        if (!state.pending || currentTime - state.lastTriggerTime < debounceDuration)
+        {
+            continue;
+        }
+
+        // Cleared before the callback, which may feed new values back in
+        state.pending = false;
+        state.triggered = false;
+        const int deviceId = state.deviceId;
+        const bool newValue = state.pendingValue;
+        if (callback)
+        {
+            callback(deviceId, newValue);
+            NDL_INFO(DEBOUNCE, "Device ID: %d, Applied Pending Value: %s\n", deviceId, newValue ? "true" : "false");
+        }
+    }
+}
+
+template <typename Policies>
+void NodeDecisionEngine<Policies>::updateDeviceValues(String &valueString)
+{
+    NDL_DEBUG(EVAL, "Updating Device Values...\n");
+
+#ifdef NDL_FIXED_CAPACITY
+    JsonDocument &doc = document;
+#else
+    DynamicJsonDocument doc(NDL_JSON_CAPACITY);
+#endif
+    DeserializationError error = deserializeJson(doc, valueString.c_str(), valueString.length());
+
+    if (error)
+    {
+        NDL_ERROR(EVAL, "Failed to parse JSON: %s\n", error.c_str());
+        return;
+    }
+
+    // Device input nodes reading a sensor whose value actually changed, grouped per device
+    for (DeviceState &state : deviceStates)
+    {
+        state.dirtyNodes.clear();
+    }
+
+    JsonArray sensorArray = doc["sensorArray"].as<JsonArray>();
+    for (JsonObject reading : sensorArray)
+    {
+        int deviceId = reading["deviceId"];
+        NodeValue value = valueFromJson(reading["value"]);
+        if (value.type == NodeValue::String)
+        {
+            queueUnused(value.s); // Freed after this update unless a sensor keeps it
+        }
+        const int slot = sensorSlotFor(deviceId);
+        if (slot < 0)
+        {
+            NDL_WARN(EVAL, "Sensor table full, value of Device ID %d dropped\n", deviceId);
+            continue;
+        }
+        SensorState &sensor = sensors[slot];
+        if (sensor.received && sensor.value == value)
+        {
+            continue;
+        }
+        setSensorValue(sensor, value);
+        sensor.received = true;
+        NDL_DEBUG(EVAL, "\n Updated sensor value: Device ID %d -> Value %s \n",
+                  deviceId, valueToString(value).c_str());
+
+        for (const auto &reader : sensor.readers)
+        {
+            deviceStates[reader.deviceSlot].dirtyNodes.push_back(reader.nodeIndex);
+        }
+        for (int programSlot : sensor.programs)
+        {
+            deviceStates[programSlot].programDirty = true;
+        }
+    }
+
+    for (auto it = devicePlans.begin(); it != devicePlans.end(); ++it)
+    {
+        int deviceId = it->first;
+        if (devicePrograms.count(deviceId) > 0)
+        {
+            continue;
+        }
+        const auto &dirtyNodes = deviceStates[it->second.deviceSlot].dirtyNodes;
+        if (it->second.needsFullEvaluation)
+        {
+            NDL_DEBUG(EVAL, "Processing Device ID: %d (full)\n", deviceId);
+            evaluatePlan(deviceId);
+        }
+        else if (!dirtyNodes.empty())
+        {
+            NDL_DEBUG(EVAL, "Processing Device ID: %d\n", deviceId);
+            evaluateDirty(deviceId, dirtyNodes);
+        }
+    }
+    for (auto &entry : devicePrograms)
+    {
+        DeviceState &state = deviceStates[entry.second.deviceSlot];
+        if (entry.second.needsRun || state.programDirty)
+        {
+            state.programDirty = false;
+            NDL_DEBUG(EVAL, "Processing Device ID: %d (bytecode)\n", entry.first);
+            runProgram(entry.first, entry.second);
+        }
+    }
+    // Every slot now holds current sensor values, so replaced strings can go
+    reclaimStrings();
+    NDL_DEBUG(EVAL, "Device values updated successfully.\n");
+}
+
+template <typename Policies>
+void NodeDecisionEngine<Policies>::processDeviceChange(int deviceSlot, bool newValue)
+{
+    DeviceState &state = deviceStates[deviceSlot];
+    const int deviceId = state.deviceId;
+    unsigned long currentTime = Clock::now();
+    if (state.pending && state.pendingValue != newValue)
+    {
+        NDL_WARN(DEBOUNCE, "Device ID %d: Oscillating state detected. Ignoring intermediate state.\n", deviceId);
+        state.lastTriggerTime = currentTime;
+        state.pendingValue = newValue;
+        return;
+    }
+
+    if (!state.triggered || (currentTime - state.lastTriggerTime >= debounceDuration))
+    {
+        state.triggered = true;
+        state.lastTriggerTime = currentTime;
+        state.pending = true;
+        state.pendingValue = newValue;
+        if (callback)
+        {
+            callback(deviceId, newValue);
+        }
+    }
+    else
+    {
+        NDL_DEBUG(DEBOUNCE, "Device ID %d: Waiting for debounce duration. Current state: %s\n", deviceId, newValue ? "true" : "false");
+    }
+}
+template <typename Policies>
+void NodeDecisionEngine<Policies>::setDebounceDuration(unsigned long duration)
+{
+    debounceDuration = duration;
+    NDL_INFO(DEBOUNCE, "Debounce duration set to %lu milliseconds.\n", debounceDuration);
+}
+
+template <typename Policies>
+void NodeDecisionEngine<Policies>::setCallback(std::function<void(int, bool)> callbackFunc)
+{
+    callback = callbackFunc;
+}
+template <typename Policies>
+int NodeDecisionEngine<Policies>::getVersion()
+{
+    return version;
+}
+
+#include "NodeDecisionCodegenImpl.h"
+
+#endif
@@ -0,0 +1,241 @@
+#ifndef NODE_DECISION_FIXED_H
+#define NODE_DECISION_FIXED_H
+
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include <utility>
+
+// Containers whose storage is held in place, used by NDL_FIXED_CAPACITY builds
+// instead of the std::map and std::set tables of the engine. Each keeps its
+// entries sorted in one array, so lookups are a binary search and nothing is
+// ever taken from the heap.
+
+// Map of at most Capacity entries. Iteration is in key order, like std::map,
+// and entries expose first and second. Inserting or erasing moves the entries
+// behind the position by move construction, so values holding arena
+// allocators stay in their arena; iterators are invalidated as for std::vector.
+// emplace fails on a full map, and operator[] needs the key present or room
+// for it.
+template <typename Key, typename Value, size_t Capacity>
+class NodeFixedMap
+{
+    static_assert(Capacity > 0, "NodeFixedMap needs a capacity");
+
+public:
+    typedef Key key_type;
+    struct value_type
+    {
+        template <typename... Args>
+        explicit value_type(const Key &key, Args &&...args) : first(key), second(std::forward<Args>(args)...) {}
+        value_type(value_type &&other) : first(other.first), second(std::move(other.second)) {}
+
+        Key first;
+        Value second;
+    };
+    typedef value_type *iterator;
+    typedef const value_type *const_iterator;
+
+    NodeFixedMap() {}
+    ~NodeFixedMap() { clear(); }
+    NodeFixedMap(const NodeFixedMap &) = delete;
+    NodeFixedMap &operator=(const NodeFixedMap &) = delete;
+
+    iterator begin() { return entries(); }
+    iterator end() { return entries() + used; }
+    const_iterator begin() const { return entries(); }
+    const_iterator end() const { return entries() + used; }
+    size_t size() const { return used; }
+    bool empty() const { return used == 0; }
+
+    iterator find(const Key &key)
+    {
+        iterator position = lowerBound(key);
+        return position != end() && !(key < position->first) ? position : end();
+    }
+    const_iterator find(const Key &key) const { return const_cast<NodeFixedMap *>(this)->find(key); }
+    size_t count(const Key &key) const { return find(key) != end() ? 1 : 0; }
+
+    // Like std::map::emplace; on a full map returns end() and false
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(const Key &key, Args &&...args)
+    {
+        iterator position = lowerBound(key);
+        if (position != end() && !(key < position->first))
+        {
+            return std::make_pair(position, false);
+        }
+        if (used == Capacity)
+        {
+            return std::make_pair(end(), false);
+        }
+        for (iterator slot = end(); slot != position; --slot)
+        {
+            ::new (static_cast<void *>(slot)) value_type(std::move(*(slot - 1)));
+            (slot - 1)->~value_type();
+        }
+        ::new (static_cast<void *>(position)) value_type(key, std::forward<Args>(args)...);
+        used++;
+        return std::make_pair(position, true);
+    }
+
+    Value &operator[](const Key &key) { return emplace(key).first->second; }
+
+    iterator erase(iterator position)
+    {
+        position->~value_type();
+        for (iterator slot = position; slot + 1 != end(); ++slot)
+        {
+            ::new (static_cast<void *>(slot)) value_type(std::move(*(slot + 1)));
+            (slot + 1)->~value_type();
+        }
+        used--;
+        return position;
+    }
+    size_t erase(const Key &key)
+    {
+        iterator position = find(key);
+        if (position == end())
+        {
+            return 0;
+        }
+        erase(position);
+        return 1;
+    }
+
+    void clear()
+    {
+        while (used > 0)
+        {
+            entries()[--used].~value_type();
+        }
+    }
+
+private:
+    typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type storage[Capacity];
+    size_t used = 0;
+
+    value_type *entries() { return reinterpret_cast<value_type *>(storage); }
+    const value_type *entries() const { return reinterpret_cast<const value_type *>(storage); }
+
+    iterator lowerBound(const Key &key)
+    {
+        size_t low = 0;
+        size_t high = used;
+        while (low < high)
+        {
+            size_t middle = (low + high) / 2;
+            if (entries()[middle].first < key)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        return entries() + low;
+    }
+};
+
+// Sorted set of at most Capacity values of a trivially copyable type. Inserts
+// into a full set are dropped, so a set one larger than a limit tells whether
+// the limit was passed.
+template <typename T, size_t Capacity>
+class NodeFixedSet
+{
+    static_assert(Capacity > 0, "NodeFixedSet needs a capacity");
+
+public:
+    typedef const T *const_iterator;
+
+    const_iterator begin() const { return values; }
+    const_iterator end() const { return values + used; }
+    size_t size() const { return used; }
+    size_t count(const T &value) const
+    {
+        const_iterator position = lowerBound(value);
+        return position != end() && !(value < *position) ? 1 : 0;
+    }
+
+    // True if the value was added
+    bool insert(const T &value)
+    {
+        T *position = const_cast<T *>(lowerBound(value));
+        if ((position != end() && !(value < *position)) || used == Capacity)
+        {
+            return false;
+        }
+        memmove(position + 1, position, (end() - position) * sizeof(T));
+        *position = value;
+        used++;
+        return true;
+    }
+
+private:
+    T values[Capacity];
+    size_t used = 0;
+
+    const_iterator lowerBound(const T &value) const
+    {
+        size_t low = 0;
+        size_t high = used;
+        while (low < high)
+        {
+            size_t middle = (low + high) / 2;
+            if (values[middle] < value)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        return values + low;
+    }
+};
+
+// Text of at most Capacity bytes stored inline, with the parts of the
+// std::string interface the engine uses. The caller checks the length.
+template <size_t Capacity>
+class NodeFixedString
+{
+public:
+    NodeFixedString() { text[0] = '\0'; }
+
+    NodeFixedString &assign(const char *data, size_t size)
+    {
+        length = size < Capacity ? size : Capacity;
+        memcpy(text, data, length);
+        text[length] = '\0';
+        return *this;
+    }
+    void swap(NodeFixedString &other)
+    {
+        NodeFixedString held = other;
+        other = *this;
+        *this = held;
+    }
+
+    const char *c_str() const { return text; }
+    const char *data() const { return text; }
+    size_t size() const { return length; }
+    bool operator==(const char *other) const { return strlen(other) == length && memcmp(text, other, length) == 0; }
+
+private:
+    char text[Capacity + 1];
+    size_t length = 0;
+};
+
+// Key of a string index that refers to text stored elsewhere; ordered like
+// std::string, byte by byte and then by length
+struct NodeStringKey
+{
+    NodeStringKey(const char *text, size_t length) : text(text), length(length) {}
+
+    bool operator<(const NodeStringKey &other) const
+    {
+        int order = memcmp(text, other.text, length < other.length ? length : other.length);
+        return order < 0 || (order == 0 && length < other.length);
+    }
+
+    const char *text;
+    size_t length;
+};
+
+#endif
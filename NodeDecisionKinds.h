@@ -0,0 +1,244 @@
+#ifndef NODE_DECISION_KINDS_H
+#define NODE_DECISION_KINDS_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Node kinds indexed directly by availableId. Kernels take a fixed number of
+// inputs by pointer, so evaluating a node needs no lookup and no allocation.
+
+enum NodeCategory : uint8_t
+{
+    NODE_UNKNOWN,
+    NODE_LOGIC,        // boolean in, boolean out
+    NODE_MATH,         // numeric in, numeric out
+    NODE_COMPARE,      // numeric in, boolean out
+    NODE_FINAL,        // drives the device callback
+    NODE_DEVICE_INPUT  // reads a sensor value
+};
+
+enum NodeSignal : uint8_t
+{
+    SIGNAL_NONE,
+    SIGNAL_BOOLEAN,
+    SIGNAL_NUMBER,
+    SIGNAL_ANY
+};
+
+typedef bool (*LogicKernel)(const bool *inputs);
+typedef uint64_t (*LaneKernel)(const uint64_t *inputs); // 64 boolean scenarios per word
+typedef void (*ColumnKernel)(const double *const *inputs, double *output, size_t count); // booleans as 0/1
+
+// Math and comparison kernels are instantiated for the engine's number type
+template <typename Number>
+struct NodeKindOf
+{
+    typedef Number (*MathKernel)(const Number *inputs);
+    typedef bool (*CompareKernel)(const Number *inputs);
+
+    const char *name;
+    NodeCategory category;
+    uint8_t arity;
+    NodeSignal inputType;
+    NodeSignal outputType;
+    bool commutative;
+    LogicKernel logic;
+    LaneKernel lanes;
+    MathKernel math;
+    CompareKernel compare;
+    ColumnKernel column;
+    const char *symbol; // scalar kernel name, for generated code
+};
+typedef NodeKindOf<double> NodeKind;
+typedef NodeKind::MathKernel MathKernel;
+typedef NodeKind::CompareKernel CompareKernel;
+
+namespace NodeKernels
+{
+    // Boolean Logic Nodes
+    inline bool notGate(const bool *in) { return !in[0]; }
+    inline bool andGate(const bool *in) { return in[0] && in[1]; }
+    inline bool orGate(const bool *in) { return in[0] || in[1]; }
+    inline bool xorGate(const bool *in) { return in[0] ^ in[1]; }
+    inline bool norGate(const bool *in) { return !(in[0] || in[1]); }
+    inline bool nandGate(const bool *in) { return !(in[0] && in[1]); }
+    inline bool xnorGate(const bool *in) { return !(in[0] ^ in[1]); }
+    inline bool finalGate(const bool *in) { return in[0]; }
+
+    // Boolean Logic Nodes, one bit per scenario
+    inline uint64_t notLanes(const uint64_t *in) { return ~in[0]; }
+    inline uint64_t andLanes(const uint64_t *in) { return in[0] & in[1]; }
+    inline uint64_t orLanes(const uint64_t *in) { return in[0] | in[1]; }
+    inline uint64_t xorLanes(const uint64_t *in) { return in[0] ^ in[1]; }
+    inline uint64_t norLanes(const uint64_t *in) { return ~(in[0] | in[1]); }
+    inline uint64_t nandLanes(const uint64_t *in) { return ~(in[0] & in[1]); }
+    inline uint64_t xnorLanes(const uint64_t *in) { return ~(in[0] ^ in[1]); }
+    inline uint64_t finalLanes(const uint64_t *in) { return in[0]; }
+
+    // Mathematical Nodes (Function)
+    template <typename T> inline T add(const T *in) { return in[0] + in[1]; }
+    template <typename T> inline T subtract(const T *in) { return in[0] - in[1]; }
+    template <typename T> inline T multiply(const T *in) { return in[0] * in[1]; }
+    template <typename T> inline T divide(const T *in) { return in[1] != 0 ? in[0] / in[1] : 0; } // Avoid Zero Division
+    template <typename T> inline T power(const T *in) { return pow(in[0], in[1]); }
+    template <typename T> inline T logarithm(const T *in) { return log(in[0]); }
+    template <typename T> inline T squareRoot(const T *in) { return sqrt(in[0]); }
+    template <typename T> inline T absolute(const T *in) { return fabs(in[0]); }
+    template <typename T> inline T exponent(const T *in) { return exp(in[0]); }
+    template <typename T> inline T minimum(const T *in) { return in[1] < in[0] ? in[1] : in[0]; }
+    template <typename T> inline T maximum(const T *in) { return in[0] < in[1] ? in[1] : in[0]; }
+
+    // Comparison Nodes (Return Boolean)
+    template <typename T> inline bool lessThan(const T *in) { return in[0] < in[1]; }
+    template <typename T> inline bool greaterThan(const T *in) { return in[0] > in[1]; }
+    template <typename T> inline bool lessOrEqual(const T *in) { return in[0] <= in[1]; }
+    template <typename T> inline bool greaterOrEqual(const T *in) { return in[0] >= in[1]; }
+    template <typename T> inline bool equal(const T *in) { return in[0] == in[1]; }
+    template <typename T> inline bool notEqual(const T *in) { return in[0] != in[1]; }
+
+    // Rounding Nodes (Function)
+    template <typename T> inline T roundValue(const T *in) { return round(in[0]); }
+    template <typename T> inline T floorValue(const T *in) { return floor(in[0]); }
+    template <typename T> inline T ceilValue(const T *in) { return ceil(in[0]); }
+
+    // Column kernels: one scalar kernel applied over a block of samples. The
+    // kernel is a template argument so it inlines into a loop the compiler can
+    // vectorize.
+    template <bool (*Kernel)(const bool *), int Arity>
+    void logicColumn(const double *const *in, double *out, size_t count)
+    {
+        const double *a = in[0];
+        const double *b = Arity > 1 ? in[1] : in[0];
+        for (size_t k = 0; k < count; k++)
+        {
+            const bool args[2] = {a[k] != 0.0, b[k] != 0.0};
+            out[k] = Kernel(args) ? 1.0 : 0.0;
+        }
+    }
+
+    template <double (*Kernel)(const double *), int Arity>
+    void mathColumn(const double *const *in, double *out, size_t count)
+    {
+        const double *a = in[0];
+        const double *b = Arity > 1 ? in[1] : in[0];
+        for (size_t k = 0; k < count; k++)
+        {
+            const double args[2] = {a[k], b[k]};
+            out[k] = Kernel(args);
+        }
+    }
+
+    template <bool (*Kernel)(const double *)>
+    void compareColumn(const double *const *in, double *out, size_t count)
+    {
+        const double *a = in[0];
+        const double *b = in[1];
+        for (size_t k = 0; k < count; k++)
+        {
+            const double args[2] = {a[k], b[k]};
+            out[k] = Kernel(args) ? 1.0 : 0.0;
+        }
+    }
+}
+
+static const int NODE_KIND_COUNT = 31;
+static const int NODE_KIND_MAX_ARITY = 2;
+static const int NODE_KIND_NOT = 1;
+static const int NODE_KIND_EQUAL = 23;
+static const int NODE_KIND_NOT_EQUAL = 24;
+
+#define NODE_KIND_LOGIC(name, arity, comm, fn, lanes) \
+    {name, NODE_LOGIC, arity, SIGNAL_BOOLEAN, SIGNAL_BOOLEAN, comm, fn, lanes, nullptr, nullptr, NodeKernels::logicColumn<fn, arity>, #fn}
+#define NODE_KIND_MATH(name, arity, comm, fn) \
+    {name, NODE_MATH, arity, SIGNAL_NUMBER, SIGNAL_NUMBER, comm, nullptr, nullptr, fn<Number>, nullptr, NodeKernels::mathColumn<fn<double>, arity>, #fn}
+#define NODE_KIND_COMPARE(name, comm, fn) \
+    {name, NODE_COMPARE, 2, SIGNAL_NUMBER, SIGNAL_BOOLEAN, comm, nullptr, nullptr, nullptr, fn<Number>, NodeKernels::compareColumn<fn<double>>, #fn}
+#define NODE_KIND_NONE {"UNKNOWN", NODE_UNKNOWN, 0, SIGNAL_NONE, SIGNAL_NONE, false, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr}
+
+// One table per number type; a class template rather than a variable
+// template so the header stays C++11.
+template <typename Number>
+struct NodeKindTable
+{
+    static constexpr NodeKindOf<Number> kinds[NODE_KIND_COUNT] = {
+        NODE_KIND_NONE,                                                                  // 0
+        NODE_KIND_LOGIC("NOT", 1, false, NodeKernels::notGate, NodeKernels::notLanes),   // 1
+        NODE_KIND_LOGIC("AND", 2, true, NodeKernels::andGate, NodeKernels::andLanes),    // 2
+        NODE_KIND_LOGIC("OR", 2, true, NodeKernels::orGate, NodeKernels::orLanes),       // 3
+        NODE_KIND_LOGIC("XOR", 2, true, NodeKernels::xorGate, NodeKernels::xorLanes),    // 4
+        NODE_KIND_LOGIC("NOR", 2, true, NodeKernels::norGate, NodeKernels::norLanes),    // 5
+        NODE_KIND_LOGIC("NAND", 2, true, NodeKernels::nandGate, NodeKernels::nandLanes), // 6
+        NODE_KIND_LOGIC("XNOR", 2, true, NodeKernels::xnorGate, NodeKernels::xnorLanes), // 7
+        NODE_KIND_MATH("ADD", 2, true, NodeKernels::add),                                // 8
+        NODE_KIND_MATH("SUBTRACT", 2, false, NodeKernels::subtract),                     // 9
+        NODE_KIND_MATH("MULTIPLY", 2, true, NodeKernels::multiply),                      // 10
+        NODE_KIND_MATH("DIVIDE", 2, false, NodeKernels::divide),                         // 11
+        NODE_KIND_MATH("POWER", 2, false, NodeKernels::power),                           // 12
+        NODE_KIND_MATH("LOGARITHM", 1, false, NodeKernels::logarithm),                   // 13
+        NODE_KIND_MATH("SQUARE ROOT", 1, false, NodeKernels::squareRoot),                // 14
+        NODE_KIND_MATH("ABSOLUTE", 1, false, NodeKernels::absolute),                     // 15
+        NODE_KIND_MATH("EXPONENT", 1, false, NodeKernels::exponent),                     // 16
+        NODE_KIND_MATH("MIN", 2, false, NodeKernels::minimum),                           // 17
+        NODE_KIND_MATH("MAX", 2, false, NodeKernels::maximum),                           // 18
+        NODE_KIND_COMPARE("LESS THAN", false, NodeKernels::lessThan),                    // 19
+        NODE_KIND_COMPARE("GREATER THAN", false, NodeKernels::greaterThan),              // 20
+        NODE_KIND_COMPARE("LESS THAN OR EQUAL", false, NodeKernels::lessOrEqual),        // 21
+        NODE_KIND_COMPARE("GREATER THAN OR EQUAL", false, NodeKernels::greaterOrEqual),  // 22
+        NODE_KIND_COMPARE("EQUAL", true, NodeKernels::equal),                            // 23
+        NODE_KIND_COMPARE("NOT EQUAL", true, NodeKernels::notEqual),                     // 24
+        NODE_KIND_MATH("ROUND", 1, false, NodeKernels::roundValue),                      // 25
+        NODE_KIND_MATH("FLOOR", 1, false, NodeKernels::floorValue),                      // 26
+        NODE_KIND_MATH("CEIL", 1, false, NodeKernels::ceilValue),                        // 27
+        {"FINAL", NODE_FINAL, 1, SIGNAL_BOOLEAN, SIGNAL_NONE, false, NodeKernels::finalGate, NodeKernels::finalLanes,
+         nullptr, nullptr, NodeKernels::logicColumn<NodeKernels::finalGate, 1>, "NodeKernels::finalGate"}, // 28
+        NODE_KIND_NONE,                                                                  // 29
+        {"DEVICE INPUT", NODE_DEVICE_INPUT, 0, SIGNAL_NONE, SIGNAL_ANY, false, nullptr, nullptr,
+         nullptr, nullptr, nullptr, nullptr}, // 30
+    };
+};
+
+template <typename Number>
+constexpr NodeKindOf<Number> NodeKindTable<Number>::kinds[NODE_KIND_COUNT];
+
+#undef NODE_KIND_LOGIC
+#undef NODE_KIND_MATH
+#undef NODE_KIND_COMPARE
+#undef NODE_KIND_NONE
+
+static constexpr const NodeKind *nodeKinds = NodeKindTable<double>::kinds;
+
+template <typename Number = double>
+constexpr const NodeKindOf<Number> &nodeKindFor(int availableId)
+{
+    return (availableId > 0 && availableId < NODE_KIND_COUNT) ? NodeKindTable<Number>::kinds[availableId]
+                                                              : NodeKindTable<Number>::kinds[0];
+}
+
+// Truth table of a gate over two inputs, bit (a | b << 1). NOT ignores b.
+template <typename Number>
+inline uint8_t gateTruthTable(const NodeKindOf<Number> &kind)
+{
+    uint8_t table = 0;
+    for (int k = 0; k < 4; k++)
+    {
+        const bool inputs[2] = {(k & 1) != 0, (k & 2) != 0};
+        table |= static_cast<uint8_t>(kind.logic(inputs)) << k;
+    }
+    return table;
+}
+
+// availableId of the two-input gate computing the table, 0 if there is none
+inline int gateWithTruthTable(uint8_t table)
+{
+    for (int id = 0; id < NODE_KIND_COUNT; id++)
+    {
+        if (nodeKinds[id].category == NODE_LOGIC && nodeKinds[id].arity == 2 && gateTruthTable(nodeKinds[id]) == table)
+        {
+            return id;
+        }
+    }
+    return 0;
+}
+
+#endif
@@ -6,16 +6,186 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include <memory>
 #include <queue>
+#include <set>
 #include <Arduino.h>
 #include <chrono> 
+#include <stdint.h>
+#include "NodeDecisionKinds.h"
+#include "NodeDecisionBdd.h"
+#include "NodeDecisionBytecode.h"
+#include "NodeDecisionFixed.h"
+#include "NodeDecisionPolicies.h"
 
-class NodeDecisionLibrary
+// Capacity limits, settable with build flags such as -DNDL_MAX_DEVICES=4.
+// decodeLogicData and loadProgram reject logic that would exceed them, leaving
+// the device's previous logic in place; 0 leaves a limit off. NDL_FIXED_CAPACITY
+// turns every limit on and holds the engine's tables, parsed JSON, device
+// arenas and diagram builder inside the engine, so that after construction
+// only the scratch of compile passes comes from the heap.
+#ifdef NDL_FIXED_CAPACITY
+#ifndef NDL_MAX_DEVICES
+#define NDL_MAX_DEVICES 8
+#endif
+#ifndef NDL_MAX_NODES_PER_DEVICE
+#define NDL_MAX_NODES_PER_DEVICE 64
+#endif
+#ifndef NDL_MAX_RELATIONSHIPS
+#define NDL_MAX_RELATIONSHIPS 128
+#endif
+#ifndef NDL_MAX_SENSORS
+#define NDL_MAX_SENSORS 32
+#endif
+#ifndef NDL_MAX_STRINGS
+#define NDL_MAX_STRINGS 128
+#endif
+#ifndef NDL_MAX_STRING_LENGTH
+#define NDL_MAX_STRING_LENGTH 31
+#endif
+#ifndef NDL_ARENA_BYTES
+#define NDL_ARENA_BYTES 8192
+#endif
+#ifndef NDL_BDD_NODES
+#define NDL_BDD_NODES 512
+#endif
+#endif
+
+#ifndef NDL_MAX_DEVICES
+#define NDL_MAX_DEVICES 0          // devices with logic
+#endif
+#ifndef NDL_MAX_NODES_PER_DEVICE
+#define NDL_MAX_NODES_PER_DEVICE 0 // entries of "n"
+#endif
+#ifndef NDL_MAX_RELATIONSHIPS
+#define NDL_MAX_RELATIONSHIPS 0    // entries of "r", per device
+#endif
+#ifndef NDL_MAX_SENSORS
+#define NDL_MAX_SENSORS 0          // distinct sensors read by logic or holding a value
+#endif
+#ifndef NDL_MAX_STRINGS
+#define NDL_MAX_STRINGS 0          // distinct strings held at once
+#endif
+#ifndef NDL_MAX_STRING_LENGTH
+#define NDL_MAX_STRING_LENGTH 0    // bytes of one string
+#endif
+#ifndef NDL_ARENA_BYTES
+#define NDL_ARENA_BYTES 0          // bytes of each pooled device arena, NDL_FIXED_CAPACITY only
+#endif
+#ifndef NDL_BDD_NODES
+#define NDL_BDD_NODES 4096         // nodes of the decision diagrams of one plan
+#endif
+#ifndef NDL_JSON_CAPACITY
+#define NDL_JSON_CAPACITY 16384    // bytes of a parsed payload
+#endif
+#if defined(NDL_FIXED_CAPACITY) && (NDL_MAX_DEVICES == 0 || NDL_MAX_RELATIONSHIPS == 0 || NDL_MAX_SENSORS == 0 || \
+                                    NDL_MAX_STRINGS == 0 || NDL_MAX_STRING_LENGTH == 0)
+#error "NDL_FIXED_CAPACITY needs every limit but NDL_MAX_NODES_PER_DEVICE to size its tables"
+#endif
+
+// Tagged value carried by node inputs, outputs and sensor readings.
+// Strings are stored as handles into the library's intern table.
+struct NodeValue
+{
+    enum Type : uint8_t
+    {
+        Null,
+        Bool,
+        Int,
+        Double,
+        String
+    };
+
+    Type type = Null;
+    union
+    {
+        bool b;
+        int64_t i;
+        double d;
+        uint32_t s;
+    };
+
+    NodeValue() : i(0) {}
+    static NodeValue fromBool(bool value)
+    {
+        NodeValue v;
+        v.type = Bool;
+        v.b = value;
+        return v;
+    }
+    static NodeValue fromInt(int64_t value)
+    {
+        NodeValue v;
+        v.type = Int;
+        v.i = value;
+        return v;
+    }
+    static NodeValue fromDouble(double value)
+    {
+        NodeValue v;
+        v.type = Double;
+        v.d = value;
+        return v;
+    }
+    static NodeValue fromString(uint32_t handle)
+    {
+        NodeValue v;
+        v.type = String;
+        v.s = handle;
+        return v;
+    }
+
+    bool operator==(const NodeValue &other) const
+    {
+        if (type != other.type)
+            return false;
+        switch (type)
+        {
+        case Bool:
+            return b == other.b;
+        case Int:
+            return i == other.i;
+        case Double:
+            return d == other.d;
+        case String:
+            return s == other.s;
+        default:
+            return true;
+        }
+    }
+    bool operator!=(const NodeValue &other) const { return !(*this == other); }
+};
+
+// The decision engine, parameterized by a policy set (see NodeDecisionPolicies.h).
+// NodeDecisionLibrary is the engine with the default policies; other policy
+// sets need NodeDecisionEngineImpl.h in the translation unit that uses them.
+template <typename Policies = NodeDecisionDefaultPolicies>
+class NodeDecisionEngine
 {
 public:
-    NodeDecisionLibrary();
+    // Optional passes run by decodeLogicData, combined as a bit mask
+    enum CompileOptions : uint32_t
+    {
+        COMPILE_BDD = 1 << 0,      // collapse boolean gate cones into decision diagrams
+        COMPILE_LOOKUP = 1 << 1,   // collapse gate cones reading at most six slots into truth tables
+        COMPILE_MINIMIZE = 1 << 2, // rewrite gates into a smaller equivalent network
+        COMPILE_FUSE = 1 << 3,     // run single-consumer math chains as one fused kernel
+        COMPILE_BYTECODE = 1 << 4, // run the device on the bytecode interpreter
+        COMPILE_DEFAULT = COMPILE_LOOKUP | COMPILE_FUSE
+    };
+
+    NodeDecisionEngine();
+    void setCompileOptions(uint32_t options);
     bool decodeLogicData(const String &jsonPayload, int deviceId);
+    bool isLogicEquivalent(int deviceIdA, int deviceIdB);
+    int minimizedGateCount(int deviceId) const;
+    bool exportProgram(int deviceId, std::vector<uint8_t> &bytes);
+    bool loadProgram(int deviceId, const uint8_t *bytes, size_t size);
+    bool generateCode(int deviceId, const char *name, std::string &source);
     void updateDeviceValues(String &valueString);
+    bool evaluateBitParallel(int deviceId, const std::map<int, uint64_t> &sensorLanes, std::map<int, uint64_t> &finalLanes);
+    bool evaluateBatch(int deviceId, const std::map<int, std::vector<double>> &sensorColumns,
+                       std::map<int, std::vector<double>> &finalColumns);
     void printDecodedData(int deviceId) const;
     void isDebug(bool enabled); 
     void setCallback(std::function<void(int, bool)> callback);  
@@ -25,31 +195,83 @@ public:
    static bool convertToBool(const std::string &value); 
 
 private:
+    typedef typename Policies::Clock Clock;
+    typedef typename Policies::Logger Logger;
+    typedef typename Policies::Number Number;
+    typedef NodeKindOf<Number> Kind;
+    template <typename T>
+    using Vector = std::vector<T, typename Policies::template Allocator<T>>;
+    template <typename K, typename V>
+    using Map = std::map<K, V, std::less<K>, typename Policies::template Allocator<std::pair<const K, V>>>;
+    // Bound to a device's arena for the containers holding its logic; default
+    // constructed, it allocates from the heap
+    typedef typename Policies::template Allocator<int> DeviceAllocator;
+    // Tables of the engine: sorted arrays held in place under NDL_FIXED_CAPACITY,
+    // maps on the heap otherwise. DeviceMap holds an entry per device with
+    // logic, SavedEntry the one entry decodeLogicData sets aside, and
+    // ConnectorMarks the connectors named by the relationships of a payload.
+#ifdef NDL_FIXED_CAPACITY
+    template <typename T>
+    using DeviceMap = NodeFixedMap<int, T, NDL_MAX_DEVICES>;
+    template <typename T>
+    using SavedEntry = NodeFixedMap<int, T, 1>;
+    typedef NodeFixedMap<int, int, NDL_MAX_SENSORS> SensorIndex;
+    typedef NodeFixedSet<int, NDL_MAX_SENSORS + 1> SensorSet; // one past the limit, to see it passed
+    typedef NodeFixedString<NDL_MAX_STRING_LENGTH> StringText;
+    typedef NodeFixedMap<NodeStringKey, uint32_t, NDL_MAX_STRINGS> StringIndex; // keys point into the entries
+    typedef NodeFixedMap<int, bool, NDL_MAX_RELATIONSHIPS> ConnectorMarks;
+#else
+    template <typename T>
+    using DeviceMap = Map<int, T>;
+    template <typename T>
+    using SavedEntry = Map<int, T>;
+    typedef Map<int, int> SensorIndex;
+    typedef std::set<int> SensorSet;
+    typedef std::string StringText;
+    typedef Map<std::string, uint32_t> StringIndex;
+    typedef Map<int, bool> ConnectorMarks;
+#endif
+
     int version =1;
+    // Decoded description of a node. Evaluation reads the plan's flat arrays
+    // instead; these are only consulted while compiling and for debugging.
     struct InputData
     {
         int id;
-        std::string dataType;
-        std::string data;
+        uint32_t dataType; // handle into internedStrings
+        NodeValue data; // value read while no relationship feeds the input
     };
 
     struct OutputData
     {
         int id;
-        std::string dataType;
-        std::string data;
+        uint32_t dataType; // handle into internedStrings
         int deviceId;
         int configId;
     };
 
     struct NodeData
     {
+        typedef DeviceAllocator allocator_type;
+
+        explicit NodeData(const allocator_type &allocator = allocator_type()) : inputs(allocator), outputs(allocator) {}
+        NodeData(const NodeData &other, const allocator_type &allocator)
+            : id(other.id), availableId(other.availableId), kind(other.kind), data(other.data),
+              inputs(other.inputs, allocator), outputs(other.outputs, allocator) {}
+        NodeData(NodeData &&other, const allocator_type &allocator)
+            : id(other.id), availableId(other.availableId), kind(other.kind), data(other.data),
+              inputs(std::move(other.inputs), allocator), outputs(std::move(other.outputs), allocator) {}
+        NodeData(const NodeData &) = default;
+        NodeData(NodeData &&) = default;
+        NodeData &operator=(const NodeData &) = default;
+        NodeData &operator=(NodeData &&) = default;
+
         int id;
         int availableId;
-        std::string kind;
-        std::string data;
-        std::vector<InputData> inputs;
-        std::vector<OutputData> outputs;
+        uint32_t kind; // handle into internedStrings
+        NodeValue data;
+        Vector<InputData> inputs;
+        Vector<OutputData> outputs;
     };
 
     struct RelationshipData
@@ -60,25 +282,269 @@ private:
         int configId;
     };
 
-    std::map<int, std::vector<NodeData>> deviceNodes;
-    std::map<int, std::vector<RelationshipData>> deviceRelationships;
-    std::map<int, std::map<int, std::string>> deviceDIds;
-    std::map<int, std::string> deviceValues;
+    // A gate cone collapsed into its root node. The root keeps its outputs but
+    // reads the cone's leaf slots and is evaluated by a table lookup or by
+    // walking a diagram.
+    struct ConeProgram
+    {
+        typedef DeviceAllocator allocator_type;
+
+        explicit ConeProgram(const allocator_type &allocator = allocator_type()) : leaves(allocator) {}
+        ConeProgram(const ConeProgram &other, const allocator_type &allocator)
+            : leaves(other.leaves, allocator), bddRoot(other.bddRoot), lookup(other.lookup), truthTable(other.truthTable) {}
+        ConeProgram(ConeProgram &&other, const allocator_type &allocator)
+            : leaves(std::move(other.leaves), allocator), bddRoot(other.bddRoot), lookup(other.lookup),
+              truthTable(other.truthTable) {}
+        ConeProgram(const ConeProgram &) = default;
+        ConeProgram(ConeProgram &&) = default;
+        ConeProgram &operator=(const ConeProgram &) = default;
+        ConeProgram &operator=(ConeProgram &&) = default;
+
+        Vector<int> leaves;  // slots the cone reads; leaf i is bit i of the table index
+        uint32_t bddRoot;         // into CompiledPlan::bddNodes, valid when diagrams are kept
+        bool lookup;              // evaluate through truthTable
+        uint64_t truthTable;
+    };
+    static const size_t CONE_TABLE_MAX_LEAVES = 6;
+
+    // One math or comparison node inside a fused kernel. Each operand is the
+    // register of an earlier step, a live slot, or a literal, in that order.
+    struct FusedStep
+    {
+        typename Kind::MathKernel math;   // null for comparisons
+        typename Kind::CompareKernel compare;
+        int8_t operandRegister[NODE_KIND_MAX_ARITY];
+        int operandSlot[NODE_KIND_MAX_ARITY];
+        Number operandValue[NODE_KIND_MAX_ARITY];
+    };
+
+    // A tree of math nodes fused into the node reading its result; the last
+    // step is that node
+    struct FusedProgram
+    {
+        typedef DeviceAllocator allocator_type;
+
+        explicit FusedProgram(const allocator_type &allocator = allocator_type()) : steps(allocator), leaves(allocator) {}
+        FusedProgram(const FusedProgram &other, const allocator_type &allocator)
+            : steps(other.steps, allocator), leaves(other.leaves, allocator) {}
+        FusedProgram(FusedProgram &&other, const allocator_type &allocator)
+            : steps(std::move(other.steps), allocator), leaves(std::move(other.leaves), allocator) {}
+        FusedProgram(const FusedProgram &) = default;
+        FusedProgram(FusedProgram &&) = default;
+        FusedProgram &operator=(const FusedProgram &) = default;
+        FusedProgram &operator=(FusedProgram &&) = default;
+
+        Vector<FusedStep> steps;
+        Vector<int> leaves;  // slots the steps read
+    };
+    static const size_t FUSED_MAX_STEPS = 16;
+
+    // Evaluation plan built once per decodeLogicData and reused on every update.
+    // Nodes are addressed by their index in deviceNodes, outputs by a dense slot.
+    struct CompiledPlan
+    {
+        explicit CompiledPlan(const DeviceAllocator &allocator = DeviceAllocator())
+            : order(allocator), graphOrder(allocator), outputSlotBase(allocator), inputSources(allocator),
+              slotNode(allocator), slotSensor(allocator), slotIndex(allocator), slotValues(allocator),
+              slotBits(allocator), rank(allocator), consumers(allocator), queued(allocator),
+              finalState(allocator), finalNodes(allocator), nodeCone(allocator), cones(allocator),
+              nodeFused(allocator), fused(allocator), nodeKind(allocator), inputBase(allocator),
+              inputSlot(allocator), inputValue(allocator), bddNodes(allocator), bddVarSlots(allocator),
+              bddVarKeys(allocator) {}
+
+        Vector<int> order;                // node indices in evaluation order
+        Vector<int> graphOrder;           // order before cones were collapsed
+        Vector<int> outputSlotBase;       // per node, plus one past the end: slot of its first output
+        Vector<Vector<int>> inputSources; // per node, per input: source slot or -1
+        Vector<int> slotNode;             // per slot: owning node index
+        Vector<int> slotSensor;           // per slot: sensor slot read by a device input node, -1 if none
+        Vector<int> slotIndex;            // per slot: index into slotValues, or ~bit in slotBits if boolean
+        Vector<NodeValue> slotValues;     // last computed value of each non-boolean slot
+        Vector<uint64_t> slotBits;        // last computed value of each boolean slot, 64 per word
+        Vector<int> rank;                 // per node: position in order, -1 if never evaluated
+        Vector<Vector<int>> consumers;    // per node: nodes reading any of its outputs
+        Vector<bool> queued;              // per node: already scheduled this update
+        Vector<int8_t> finalState;        // per node: last value sent for a final node, -1 if none
+        Vector<int> finalNodes;           // indices of final nodes
+        Vector<int> nodeCone;             // per node: index into cones, -1 if evaluated by kind
+        Vector<ConeProgram> cones;
+        Vector<int> nodeFused;            // per node: index into fused, -1 if not fused
+        Vector<FusedProgram> fused;
+        // Hot evaluation data, one contiguous array per field
+        Vector<uint8_t> nodeKind;         // per node: availableId, 0 if unknown
+        Vector<int> inputBase;            // per node, plus one past the end: first entry of inputSlot/inputValue
+        Vector<int> inputSlot;            // per input: source slot or -1
+        Vector<NodeValue> inputValue;     // per input: its default, or the last value read by a non-gate node
+        Vector<BddNode> bddNodes;         // shared by all cones of the plan
+        Vector<int> bddVarSlots;          // per variable: slot it reads
+        Vector<int64_t> bddVarKeys;       // per variable: sensor deviceId, or -1 - slot if device-local
+        int slotCount = 0;
+        int foldedNodes = 0;
+        int mergedNodes = 0;
+        int prunedNodes = 0;
+        int minimizedNodes = 0;
+        int collapsedNodes = 0;
+        int deviceSlot = -1;              // index into deviceStates
+        bool needsFullEvaluation = true;
+    };
+
+    // Bytecode for one device, run from the top on every update that touches it
+    struct DeviceProgram
+    {
+        explicit DeviceProgram(const DeviceAllocator &allocator = DeviceAllocator())
+            : code(allocator), constants(allocator), registers(allocator), finalIds(allocator), finalState(allocator) {}
+
+        Vector<Instruction> code;
+        Vector<NodeValue> constants;
+        Vector<NodeValue> registers;
+        Vector<int> finalIds;      // per final: node id, for debugging
+        Vector<int8_t> finalState; // per final: last value sent, -1 if none
+        int deviceSlot = -1;       // index into deviceStates
+        bool needsRun = true;
+    };
+
+    struct SensorReader
+    {
+        int deviceSlot;
+        int nodeIndex;
+    };
+
+    // External deviceIds are resolved to dense slots once, when logic is
+    // installed or a reading arrives; everything past that is an array index.
+    struct SensorState
+    {
+        int deviceId = 0;
+        NodeValue value;
+        bool received = false;
+        Vector<SensorReader> readers; // device input nodes (aId 30) reading it
+        Vector<int> programs;         // device slots running bytecode that read it
+    };
+
+    // State of a device with logic that outlives the logic itself
+    struct DeviceState
+    {
+        int deviceId = 0;
+        Vector<int> dirtyNodes;            // input nodes to evaluate this update; storage reused across updates
+        bool programDirty = false;         // its program reads a sensor that changed
+        unsigned long lastTriggerTime = 0; // valid while triggered
+        bool triggered = false;
+        bool pending = false;              // pendingValue waits for the debounce duration
+        bool pendingValue = false;
+    };
+
+    // Returns a device arena to the pool it came from, or to the heap
+    struct ArenaDeleter
+    {
+        explicit ArenaDeleter(NodeDecisionEngine *engine = nullptr) : engine(engine) {}
+        void operator()(NodeArena *arena) const { engine->releaseArena(arena); }
+        NodeDecisionEngine *engine;
+    };
+    typedef std::unique_ptr<NodeArena, ArenaDeleter> ArenaPtr;
+
+    // Declared first so the arenas outlive the containers that live in them.
+    // One arena more than devices, for new logic compiled next to the old.
+#ifdef NDL_FIXED_CAPACITY
+    NodeArenaPool<NDL_MAX_DEVICES + 1, NDL_ARENA_BYTES> arenaPool;
+#endif
+    DeviceMap<ArenaPtr> deviceArenas;
+    DeviceMap<Vector<NodeData>> deviceNodes;
+    DeviceMap<Vector<RelationshipData>> deviceRelationships;
+    DeviceMap<CompiledPlan> devicePlans;
+    DeviceMap<DeviceProgram> devicePrograms;
+    Map<int, Map<int, std::string>> deviceDIds;
+    Vector<SensorState> sensors;
+    SensorIndex sensorSlots;    // sensor deviceId -> index into sensors
+    Vector<DeviceState> deviceStates;
+    DeviceMap<int> deviceSlots; // deviceId with logic -> index into deviceStates
     std::function<void(int, bool)> callback;
-    std::map<int, std::function<bool(const std::vector<bool> &)>> nodeLogicMap;
-    std::map<int, std::function<double(const std::vector<double> &)>> mathNodeMap;
-    std::map<int, unsigned long> lastTriggerTime; 
-    std::map<int, bool> pendingValues;           
+    Vector<int> readyNodes;                 // heap of ranks used by evaluateDirty
+#ifdef NDL_FIXED_CAPACITY
+    StaticJsonDocument<NDL_JSON_CAPACITY> document;
+    BddPool<NDL_BDD_NODES> bddPool;         // diagrams are built here, then copied into the plan
+#endif
+
+    // Every distinct string the engine holds is stored here once: sensor and
+    // literal values as well as node kinds and connector data types. Values
+    // are parsed once when interned, never on the evaluation path. An entry
+    // lives while a sensor holds it or some device's logic reads it; freed
+    // handles are reused, so changing sensor text does not grow the table.
+    struct InternedString
+    {
+        StringText text;
+        bool boolValue;
+        double numberValue;
+        uint32_t sensorRefs = 0; // sensors whose current value it is
+        bool logicRef = false;   // read by the logic of some device
+        bool inUse = false;
+        bool queued = false;     // listed in unusedStrings
+    };
+    Vector<InternedString> internedStrings;
+    StringIndex internIndex;
+    Vector<uint32_t> freeStrings;   // handles of entries that were reclaimed
+    Vector<uint32_t> unusedStrings; // entries that may have lost their last holder this update
+    static const uint32_t NO_STRING = 0xFFFFFFFFu; // returned by internString when the table is full
+    bool stringsFull = false;                      // some string was turned away since last cleared
 
+    uint32_t compileOptions = COMPILE_DEFAULT;
     bool debugEnabled = false;
     unsigned long debounceDuration = 1000;       // 1 seconds debounce duration (in milliseconds)
 
-    std::vector<int> topologicalSort(int deviceId);
-    bool evaluateNodeInput(int deviceId, int targetNodeId);
+    Vector<int> topologicalSort(int deviceId);
+    void compilePlan(int deviceId, const DeviceAllocator &allocator, const CompiledPlan *previous);
+    void foldConstants(int deviceId, Vector<NodeData> &nodes, CompiledPlan &plan);
+    void mergeDuplicateNodes(Vector<NodeData> &nodes, CompiledPlan &plan);
+    void minimizeGates(Vector<NodeData> &nodes, CompiledPlan &plan);
+    void pruneDeadNodes(Vector<NodeData> &nodes, CompiledPlan &plan);
+    void collapseGateCones(Vector<NodeData> &nodes, CompiledPlan &plan);
+    void fuseMathChains(Vector<NodeData> &nodes, CompiledPlan &plan);
+    static const Vector<int> &liveSources(const CompiledPlan &plan, int nodeIndex);
+    bool finalBddRoots(const CompiledPlan &plan, Vector<uint32_t> &roots);
+    bool emitProgram(int deviceId, DeviceProgram &program);
+    void runProgram(int deviceId, DeviceProgram &program);
+    void rebuildSensorIndex();
+    bool withinLimits(int deviceId, const SensorSet &sensors);
+    int sensorSlotFor(int deviceId);
+    int deviceSlotFor(int deviceId);
+    ArenaPtr newDeviceArena(int deviceId);
+    void installArena(int deviceId, ArenaPtr arena);
+    void releaseArena(NodeArena *arena);
+    template <typename From, typename To>
+    static void moveEntry(From &from, To &to, int deviceId);
+    void evaluatePlan(int deviceId);
+    void evaluateDirty(int deviceId, const Vector<int> &dirtyNodes);
+    bool evaluateNode(int deviceId, Vector<NodeData> &nodes, CompiledPlan &plan, int nodeIndex);
+    bool storeResult(CompiledPlan &plan, int nodeIndex, const NodeValue &result);
+    NodeValue slotValue(const CompiledPlan &plan, int slot) const;
+    bool slotBool(const CompiledPlan &plan, int slot) const;
+    bool storeSlot(CompiledPlan &plan, int slot, const NodeValue &value);
+    void layoutNodes(const Vector<NodeData> &nodes, CompiledPlan &plan);
     void debugPrint(const char *format, ...);
-    void processDeviceChange(int deviceId, bool newValue);  
+    uint32_t internString(const char *text, size_t length);
+    uint32_t internString(const std::string &text) { return internString(text.data(), text.size()); }
+    void queueUnused(uint32_t handle);
+    static bool textToBool(const char *text, size_t length);
+    void setSensorValue(SensorState &sensor, const NodeValue &value);
+    void freeIfUnused(uint32_t handle);
+    void reclaimStrings();
+    void sweepStrings();
+    NodeValue valueFromJson(JsonVariant value);
+    bool valueToBool(const NodeValue &value) const;
+    Number valueToNumber(const NodeValue &value) const;
+    std::string valueToString(const NodeValue &value) const;
+    static bool isStringEquality(int availableId, const NodeValue &a, const NodeValue &b);
+    NodeValue compareValues(int availableId, const NodeValue &a, const NodeValue &b) const;
+    void processDeviceChange(int deviceSlot, bool newValue);  
    
     
 };
 
+extern template class NodeDecisionEngine<>;
+
+// A class rather than a typedef, so sketches can still forward-declare it
+class NodeDecisionLibrary : public NodeDecisionEngine<>
+{
+public:
+    using NodeDecisionEngine<>::NodeDecisionEngine;
+};
+
 #endif
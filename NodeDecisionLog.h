@@ -0,0 +1,52 @@
+#ifndef NODE_DECISION_LOG_H
+#define NODE_DECISION_LOG_H
+
+// Log statements of the engine. Each one has a level and a category, and is
+// compiled only when both pass the build-time filter below; a statement that
+// is compiled in still prints only while isDebug(true) is set, and its
+// arguments are not evaluated otherwise. Set the filter with build flags,
+// e.g. -DNDL_LOG_LEVEL=NDL_LEVEL_WARN or -DNDL_LOG_CATEGORIES=NDL_CATEGORY_DEBOUNCE.
+
+#define NDL_LEVEL_NONE 0
+#define NDL_LEVEL_ERROR 1   // the call failed
+#define NDL_LEVEL_WARN 2    // input was ignored or a pass gave up
+#define NDL_LEVEL_INFO 3    // one line per decode, compile or callback
+#define NDL_LEVEL_DEBUG 4   // per node and per update traces
+
+#define NDL_CATEGORY_DECODE (1 << 0)   // JSON parsing and graph sorting
+#define NDL_CATEGORY_COMPILE (1 << 1)  // optimization passes and programs
+#define NDL_CATEGORY_EVAL (1 << 2)     // sensor updates and node evaluation
+#define NDL_CATEGORY_DEBOUNCE (1 << 3) // callbacks and debouncing
+#define NDL_CATEGORY_ALL 0xF
+
+// Release builds (NDEBUG) compile every statement out
+#ifndef NDL_LOG_LEVEL
+#ifdef NDEBUG
+#define NDL_LOG_LEVEL NDL_LEVEL_NONE
+#else
+#define NDL_LOG_LEVEL NDL_LEVEL_DEBUG
+#endif
+#endif
+
+#ifndef NDL_LOG_CATEGORIES
+#define NDL_LOG_CATEGORIES NDL_CATEGORY_ALL
+#endif
+
+// Constant expression: true when statements of this level and category are compiled
+#define NDL_LOG_ENABLED(level, category) \
+    (NDL_LOG_LEVEL >= NDL_LEVEL_##level && (NDL_LOG_CATEGORIES & NDL_CATEGORY_##category) != 0)
+
+// For use inside engine members, which provide debugEnabled and debugPrint
+#define NDL_LOG(level, category, ...)                          \
+    do                                                         \
+    {                                                          \
+        if (NDL_LOG_ENABLED(level, category) && debugEnabled)  \
+            debugPrint(__VA_ARGS__);                           \
+    } while (0)
+
+#define NDL_ERROR(category, ...) NDL_LOG(ERROR, category, __VA_ARGS__)
+#define NDL_WARN(category, ...) NDL_LOG(WARN, category, __VA_ARGS__)
+#define NDL_INFO(category, ...) NDL_LOG(INFO, category, __VA_ARGS__)
+#define NDL_DEBUG(category, ...) NDL_LOG(DEBUG, category, __VA_ARGS__)
+
+#endif
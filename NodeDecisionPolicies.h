@@ -0,0 +1,64 @@
+#ifndef NODE_DECISION_POLICIES_H
+#define NODE_DECISION_POLICIES_H
+
+#include <Arduino.h>
+#include <chrono>
+#include <memory>
+#include "NodeDecisionArena.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+// Compile-time policies for NodeDecisionEngine. A policy set is a struct with
+// four members; derive from NodeDecisionDefaultPolicies and redeclare only the
+// ones to change:
+//
+//     struct QuietFloatPolicies : NodeDecisionDefaultPolicies
+//     {
+//         typedef NullLogger Logger;
+//         typedef float Number;
+//     };
+//     NodeDecisionEngine<QuietFloatPolicies> logicProcessor;
+
+// Milliseconds since boot, for debouncing
+struct ArduinoClock
+{
+    static unsigned long now() { return millis(); }
+};
+
+// Milliseconds from the monotonic clock of a hosted platform
+struct SteadyClock
+{
+    static unsigned long now()
+    {
+        return static_cast<unsigned long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                              std::chrono::steady_clock::now().time_since_epoch())
+                                              .count());
+    }
+};
+
+// Writes through the C library, which Arduino cores route to the serial port
+struct PrintfLogger
+{
+    static void write(const char *format, va_list args) { vprintf(format, args); }
+};
+
+// Drops every message; the calls inline to nothing
+struct NullLogger
+{
+    static void write(const char *, va_list) {}
+};
+
+struct NodeDecisionDefaultPolicies
+{
+    typedef ArduinoClock Clock;    // static unsigned long now()
+    typedef PrintfLogger Logger;   // static void write(const char *format, va_list args)
+    typedef double Number;         // arithmetic type of math and comparison nodes
+
+    // Allocator of the engine's containers. Those holding a device's logic
+    // get one constructed from the device's NodeArena *, if it takes one;
+    // everything else uses a default constructed allocator on the heap
+    template <typename T>
+    using Allocator = NodeArenaAllocator<T>;
+};
+
+#endif
@@ -0,0 +1,321 @@
+#ifndef NODE_DECISION_STATIC_H
+#define NODE_DECISION_STATIC_H
+
+// template <auto> parameters, if constexpr and fold expressions
+#if __cplusplus < 201703L
+#error "NodeDecisionStatic.h needs C++17; build with -std=gnu++17 or newer"
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include "NodeDecisionKinds.h"
+
+// Logic graphs declared at compile time. The node and relationship arrays
+// mirror the "n" and "r" entries of the JSON payload; compileStaticLogic
+// checks, sorts and lays them out as a constant, and StaticLogicEngine
+// evaluates that constant from static storage with no heap at all.
+//
+//     static constexpr StaticNodeData nodes[] = {
+//         {1, 30, {}, {11, 101}},               // sensor 101
+//         {2, 20, {{21}, {22, 30}}, {23}},      // sensor > 30
+//         {3, 28, {{31}}},                      // final
+//     };
+//     static constexpr StaticRelationshipData relationships[] = {{1, 21, 11}, {2, 31, 23}};
+//     static constexpr auto plan = compileStaticLogic(nodes, relationships, 102);
+//     StaticLogicEngine<plan> logic;
+//
+// Every node has one output; a device input node reads the sensor named by
+// its output deviceId. Values are numbers, with booleans as 0/1. As with
+// decodeLogicData, nodes that no relationship names are never evaluated.
+
+struct StaticInputData
+{
+    int id = 0;         // 0 marks an unused input
+    double data = 0;    // used while no relationship feeds the input
+};
+
+struct StaticOutputData
+{
+    int id = 0;         // 0 for nodes without an output
+    int deviceId = 0;   // sensor read by a device input node
+    int configId = 0;
+};
+
+struct StaticNodeData
+{
+    int id = 0;
+    int availableId = 0;
+    StaticInputData inputs[NODE_KIND_MAX_ARITY] = {};
+    StaticOutputData output = {};
+};
+
+struct StaticRelationshipData
+{
+    int id = 0;
+    int inputId = 0;
+    int outputId = 0;
+    int configId = 0;
+};
+
+enum StaticLogicError : uint8_t
+{
+    STATIC_LOGIC_OK,
+    STATIC_LOGIC_UNKNOWN_KIND,        // availableId is not in the kind table
+    STATIC_LOGIC_DUPLICATE_ID,        // two connectors share an id
+    STATIC_LOGIC_UNKNOWN_CONNECTOR,   // a relationship names a missing input or output
+    STATIC_LOGIC_INPUT_CONNECTED,     // two relationships feed the same input
+    STATIC_LOGIC_MISSING_SENSOR,      // a device input node has no output deviceId
+    STATIC_LOGIC_CYCLE
+};
+
+// Compiled layout of N nodes, addressed by their index in the node array
+template <size_t N>
+struct StaticLogicPlan
+{
+    StaticLogicError error = STATIC_LOGIC_OK;
+    int errorNodeId = 0;                                   // node the error was found at
+    int deviceId = 0;
+    int order[N] = {};                                     // node indices in evaluation order
+    int orderCount = 0;                                    // nodes named by a relationship
+    uint8_t kind[N] = {};                                  // availableId per node
+    int nodeIds[N] = {};
+    int source[N][NODE_KIND_MAX_ARITY] = {};               // per input: source node index, -1 for the literal
+    double literal[N][NODE_KIND_MAX_ARITY] = {};
+    int sensorSlot[N] = {};                                // per device input node: index into sensorIds
+    int sensorIds[N] = {};
+    int sensorCount = 0;
+};
+
+template <size_t N, size_t R>
+constexpr StaticLogicPlan<N> compileStaticLogic(const StaticNodeData (&nodes)[N],
+                                                const StaticRelationshipData (&relationships)[R], int deviceId)
+{
+    StaticLogicPlan<N> plan;
+    plan.deviceId = deviceId;
+    auto fail = [&plan](StaticLogicError error, int nodeId)
+    {
+        plan.error = error;
+        plan.errorNodeId = nodeId;
+        return plan;
+    };
+
+    for (size_t n = 0; n < N; n++)
+    {
+        const StaticNodeData &node = nodes[n];
+        const NodeKind &kind = nodeKindFor(node.availableId);
+        if (kind.category == NODE_UNKNOWN)
+            return fail(STATIC_LOGIC_UNKNOWN_KIND, node.id);
+        plan.kind[n] = static_cast<uint8_t>(node.availableId);
+        plan.nodeIds[n] = node.id;
+        for (int i = 0; i < NODE_KIND_MAX_ARITY; i++)
+        {
+            plan.source[n][i] = -1;
+            plan.literal[n][i] = node.inputs[i].data;
+        }
+
+        // Connector ids are unique across the whole graph
+        for (size_t m = 0; m <= n; m++)
+        {
+            const int ids[NODE_KIND_MAX_ARITY + 1] = {nodes[m].inputs[0].id, nodes[m].inputs[1].id, nodes[m].output.id};
+            for (int k = 0; k < NODE_KIND_MAX_ARITY + 1; k++)
+            {
+                if (ids[k] == 0)
+                    continue;
+                const int count = (ids[k] == node.inputs[0].id) + (ids[k] == node.inputs[1].id) + (ids[k] == node.output.id);
+                if (count > (m == n ? 1 : 0))
+                    return fail(STATIC_LOGIC_DUPLICATE_ID, node.id);
+            }
+        }
+
+        if (kind.category == NODE_DEVICE_INPUT)
+        {
+            if (node.output.deviceId == 0)
+                return fail(STATIC_LOGIC_MISSING_SENSOR, node.id);
+            int slot = 0;
+            while (slot < plan.sensorCount && plan.sensorIds[slot] != node.output.deviceId)
+                slot++;
+            if (slot == plan.sensorCount)
+                plan.sensorIds[plan.sensorCount++] = node.output.deviceId;
+            plan.sensorSlot[n] = slot;
+        }
+    }
+
+    int inDegree[N] = {};
+    bool named[N] = {};
+    for (size_t r = 0; r < R; r++)
+    {
+        int target = -1, targetInput = 0, from = -1;
+        for (size_t n = 0; n < N; n++)
+        {
+            for (int i = 0; i < NODE_KIND_MAX_ARITY; i++)
+            {
+                if (nodes[n].inputs[i].id != 0 && nodes[n].inputs[i].id == relationships[r].inputId)
+                {
+                    target = static_cast<int>(n);
+                    targetInput = i;
+                }
+            }
+            if (nodes[n].output.id != 0 && nodes[n].output.id == relationships[r].outputId)
+                from = static_cast<int>(n);
+        }
+        if (target < 0 || from < 0)
+            return fail(STATIC_LOGIC_UNKNOWN_CONNECTOR, target >= 0 ? nodes[target].id : 0);
+        if (plan.source[target][targetInput] >= 0)
+            return fail(STATIC_LOGIC_INPUT_CONNECTED, nodes[target].id);
+        plan.source[target][targetInput] = from;
+        inDegree[target]++;
+        named[target] = named[from] = true;
+    }
+
+    // Kahn's algorithm over node indices; order doubles as the queue
+    size_t head = 0, tail = 0;
+    for (size_t n = 0; n < N; n++)
+    {
+        plan.orderCount += named[n];
+        if (named[n] && inDegree[n] == 0)
+            plan.order[tail++] = static_cast<int>(n);
+    }
+    while (head < tail)
+    {
+        const int current = plan.order[head++];
+        for (size_t n = 0; n < N; n++)
+        {
+            for (int i = 0; i < NODE_KIND_MAX_ARITY; i++)
+            {
+                if (plan.source[n][i] == current && --inDegree[n] == 0)
+                    plan.order[tail++] = static_cast<int>(n);
+            }
+        }
+    }
+    if (tail != static_cast<size_t>(plan.orderCount))
+    {
+        for (size_t n = 0; n < N; n++)
+        {
+            if (inDegree[n] > 0)
+                return fail(STATIC_LOGIC_CYCLE, nodes[n].id);
+        }
+    }
+    return plan;
+}
+
+// Runtime state for one compiled plan: one value per node, one per sensor and
+// the last state sent for each final node. evaluate() is unrolled at compile
+// time, so every kernel is called by a constant and can be inlined.
+template <const auto &Plan>
+class StaticLogicEngine
+{
+    static_assert(Plan.error != STATIC_LOGIC_UNKNOWN_KIND, "static logic: a node has an unknown availableId");
+    static_assert(Plan.error != STATIC_LOGIC_DUPLICATE_ID, "static logic: two connectors share an id");
+    static_assert(Plan.error != STATIC_LOGIC_UNKNOWN_CONNECTOR, "static logic: a relationship names a missing connector");
+    static_assert(Plan.error != STATIC_LOGIC_INPUT_CONNECTED, "static logic: an input is fed by two relationships");
+    static_assert(Plan.error != STATIC_LOGIC_MISSING_SENSOR, "static logic: a device input node has no output deviceId");
+    static_assert(Plan.error != STATIC_LOGIC_CYCLE, "static logic: the graph has a cycle");
+
+    static constexpr size_t nodeCount = sizeof(Plan.order) / sizeof(Plan.order[0]);
+
+public:
+    static constexpr int deviceId = Plan.deviceId;
+
+    StaticLogicEngine()
+    {
+        for (size_t n = 0; n < nodeCount; n++)
+        {
+            finalState[n] = -1;
+        }
+    }
+
+    // Returns false when this logic does not read the sensor
+    bool setSensor(int sensorId, double value)
+    {
+        bool found = false;
+        for (int k = 0; k < Plan.sensorCount; k++)
+        {
+            if (Plan.sensorIds[k] == sensorId)
+            {
+                sensors[k] = value;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    // Evaluates every connected node once and calls callback(deviceId, value) for each
+    // final node whose value changed. Debouncing is left to the caller.
+    template <typename Callback>
+    void evaluate(Callback &&callback)
+    {
+        evaluateAll(callback, std::make_index_sequence<Plan.orderCount>());
+    }
+
+    double nodeValue(int nodeId) const
+    {
+        for (size_t n = 0; n < nodeCount; n++)
+        {
+            if (Plan.nodeIds[n] == nodeId)
+                return values[n];
+        }
+        return 0;
+    }
+
+private:
+    double values[nodeCount] = {};
+    double sensors[nodeCount] = {};
+    int8_t finalState[nodeCount];                 // last value sent, -1 if none
+
+    template <typename Callback, size_t... I>
+    void evaluateAll(Callback &callback, std::index_sequence<I...>)
+    {
+        (evaluateStep<Plan.order[I]>(callback), ...);
+    }
+
+    template <int Node, int Input>
+    double input() const
+    {
+        if constexpr (Plan.source[Node][Input] >= 0)
+            return values[Plan.source[Node][Input]];
+        else
+            return Plan.literal[Node][Input];
+    }
+
+    template <int Node, typename Callback>
+    void evaluateStep(Callback &callback)
+    {
+        constexpr NodeKind kind = nodeKinds[Plan.kind[Node]];
+        if constexpr (kind.category == NODE_DEVICE_INPUT)
+        {
+            values[Node] = sensors[Plan.sensorSlot[Node]];
+        }
+        else if constexpr (kind.category == NODE_FINAL)
+        {
+            const bool value = input<Node, 0>() != 0.0;
+            if (finalState[Node] != static_cast<int8_t>(value))
+            {
+                finalState[Node] = value;
+                callback(deviceId, value);
+            }
+        }
+        else
+        {
+            const double a = input<Node, 0>();
+            const double b = kind.arity > 1 ? input<Node, 1>() : a;
+            if constexpr (kind.category == NODE_LOGIC)
+            {
+                const bool in[2] = {a != 0.0, b != 0.0};
+                values[Node] = kind.logic(in) ? 1.0 : 0.0;
+            }
+            else if constexpr (kind.category == NODE_MATH)
+            {
+                const double in[2] = {a, b};
+                values[Node] = kind.math(in);
+            }
+            else
+            {
+                const double in[2] = {a, b};
+                values[Node] = kind.compare(in) ? 1.0 : 0.0;
+            }
+        }
+    }
+};
+
+#endif
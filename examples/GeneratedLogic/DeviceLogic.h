@@ -0,0 +1,45 @@
+// Generated by NodeDecisionLibrary::generateCode from the logic of Device ID 102.
+// Sensor values are numbers, booleans as 0/1; sensors never set read as 0.
+#ifndef DEVICELOGIC_H
+#define DEVICELOGIC_H
+
+#include <stdint.h>
+#include "NodeDecisionKinds.h"
+
+struct DeviceLogic
+{
+    enum : int { deviceId = 102 };
+    double sensors[1] = {};
+    int8_t finalState[1] = {-1};
+
+    // Returns false when this logic does not read the sensor
+    bool setSensor(int sensorId, double value)
+    {
+        switch (sensorId)
+        {
+        case 101:
+            sensors[0] = value;
+            return true;
+        default:
+            (void)value;
+            return false;
+        }
+    }
+
+    // Evaluates every node once and calls callback(deviceId, value) for each
+    // final node whose value changed. Debouncing is left to the caller.
+    template <typename Callback>
+    void evaluate(Callback &&callback)
+    {
+        const double in1[2] = {sensors[0], 30.0};
+        const bool v1 = NodeKernels::greaterThan(in1); // Node ID 2 GREATER THAN
+        const bool final0 = v1; // Final Node ID 3
+        if (finalState[0] != static_cast<int8_t>(final0))
+        {
+            finalState[0] = final0;
+            callback(deviceId, final0);
+        }
+    }
+};
+
+#endif
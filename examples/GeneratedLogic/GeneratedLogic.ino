@@ -0,0 +1,34 @@
+#include "DeviceLogic.h"
+
+// Runs logic that was turned into C++ on the development machine, so the
+// controller needs neither JSON nor the engine at boot. DeviceLogic.h was
+// generated from extras/codegen/DeviceLogic.json with
+//
+//     cd extras/codegen
+//     make example ARDUINOJSON=/path/to/ArduinoJson/src
+//
+// Relay 102 switches on while sensor 101 is above 30.
+
+const int relayPin = 5;
+DeviceLogic logic;
+
+void callbackFunction(int deviceId, bool value) {
+    Serial.print("Device ");
+    Serial.print(deviceId);
+    Serial.print(": ");
+    Serial.println(value ? "ON" : "OFF");
+    digitalWrite(relayPin, value ? HIGH : LOW);
+}
+
+void setup() {
+    Serial.begin(115200);
+    Serial.println("Node Decision Library - Generated Logic Example");
+    pinMode(relayPin, OUTPUT);
+}
+
+void loop() {
+    // Temperature in degrees Celsius from an analog sensor on A0
+    logic.setSensor(101, analogRead(A0) * 100.0 / 1023.0);
+    logic.evaluate(callbackFunction);
+    delay(1000);
+}
@@ -0,0 +1,43 @@
+#include "NodeDecisionStatic.h"
+
+// Logic declared at compile time: no JSON, no heap. The arrays mirror the
+// "n" and "r" entries of the JSON payload; a mistake in them, such as a cycle
+// or a relationship naming a missing connector, fails the build.
+//
+// NodeDecisionStatic.h needs C++17. Cores that default to an older standard
+// need -std=gnu++17 added to their build flags.
+
+// Relay 102 switches on while sensor 101 is above 30 and sensor 103 is on
+static constexpr StaticNodeData nodes[] = {
+    {1, 30, {}, {11, 101}},               // sensor 101
+    {2, 30, {}, {12, 103}},               // sensor 103
+    {3, 20, {{31}, {32, 30}}, {33}},      // GREATER THAN 30
+    {4, 2, {{41}, {42}}, {43}},           // AND
+    {5, 28, {{51}}},                      // final
+};
+
+static constexpr StaticRelationshipData relationships[] = {
+    {1, 31, 11},
+    {2, 41, 33},
+    {3, 42, 12},
+    {4, 51, 43},
+};
+
+static constexpr auto plan = compileStaticLogic(nodes, relationships, 102);
+StaticLogicEngine<plan> logic;
+
+void callbackFunction(int deviceId, bool value) {
+    Serial.printf("Device ID: %d, Value: %s\n", deviceId, value ? "true" : "false");
+}
+
+void setup() {
+    Serial.begin(115200);
+    Serial.println("Node Decision Library - Static Logic Example");
+}
+
+void loop() {
+    logic.setSensor(101, analogRead(34) / 40.95); // 0-100
+    logic.setSensor(103, digitalRead(4));
+    logic.evaluate(callbackFunction);
+    delay(1000);
+}
@@ -0,0 +1,93 @@
+// Host-side code generator: reads the logic JSON consumed by decodeLogicData
+// and writes the C++ header produced by generateCode for it.
+//
+//     ndl-codegen logic.json 102 DeviceLogic DeviceLogic.h
+//
+// The input file may be "-" for standard input and the output file may be
+// left out to write to standard output. Errors go to standard error and make
+// the tool exit with status 1.
+
+#include "NodeDecisionEngineImpl.h"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Engine messages go to standard error, so they never mix with the header
+struct StderrLogger
+{
+    static void write(const char *format, va_list args) { vfprintf(stderr, format, args); }
+};
+
+struct HostPolicies : NodeDecisionDefaultPolicies
+{
+    typedef SteadyClock Clock;
+    typedef StderrLogger Logger;
+};
+
+static bool readAll(const char *path, std::string &text)
+{
+    if (std::string(path) == "-")
+    {
+        text.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+        return true;
+    }
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 4 || argc > 5)
+    {
+        fprintf(stderr, "usage: %s <logic.json|-> <deviceId> <StructName> [output.h]\n", argv[0]);
+        return 1;
+    }
+
+    std::string json;
+    if (!readAll(argv[1], json))
+    {
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 1;
+    }
+    char *end = nullptr;
+    const long deviceId = strtol(argv[2], &end, 10);
+    if (*argv[2] == '\0' || *end != '\0')
+    {
+        fprintf(stderr, "deviceId must be an integer, got %s\n", argv[2]);
+        return 1;
+    }
+
+    NodeDecisionEngine<HostPolicies> engine;
+    engine.isDebug(true); // Only errors and warnings are compiled in, see the Makefile
+    if (!engine.decodeLogicData(String(json), static_cast<int>(deviceId)))
+    {
+        fprintf(stderr, "cannot decode %s\n", argv[1]);
+        return 1;
+    }
+    std::string source;
+    if (!engine.generateCode(static_cast<int>(deviceId), argv[3], source))
+    {
+        fprintf(stderr, "cannot generate %s from %s\n", argv[3], argv[1]);
+        return 1;
+    }
+
+    if (argc == 4)
+    {
+        fputs(source.c_str(), stdout);
+        return 0;
+    }
+    std::ofstream output(argv[4], std::ios::binary);
+    if (!(output << source))
+    {
+        fprintf(stderr, "cannot write %s\n", argv[4]);
+        return 1;
+    }
+    return 0;
+}
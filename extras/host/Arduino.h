@@ -0,0 +1,31 @@
+#ifndef NDL_HOST_ARDUINO_H
+#define NDL_HOST_ARDUINO_H
+
+// The parts of the Arduino core the library uses, for building it on a
+// development host. Put this directory on the include path ahead of any
+// Arduino installation; ArduinoJson is used as is.
+
+#include <chrono>
+#include <string>
+
+class String
+{
+public:
+    String(const char *text = "") : text(text) {}
+    String(const std::string &text) : text(text) {}
+
+    const char *c_str() const { return text.c_str(); }
+    unsigned int length() const { return static_cast<unsigned int>(text.size()); }
+
+private:
+    std::string text;
+};
+
+inline unsigned long millis()
+{
+    static const std::chrono::steady_clock::time_point boot = std::chrono::steady_clock::now();
+    return static_cast<unsigned long>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - boot).count());
+}
+
+#endif
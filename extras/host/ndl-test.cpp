@@ -0,0 +1,274 @@
+// Host test of the engine: decodes a few fixed graphs under every compile
+// option and checks what the callback reports for a series of sensor
+// values, which must not depend on the options. It then round-trips each device through exportProgram/loadProgram and
+// checks that damaged program images are refused.
+//
+//     make test ARDUINOJSON=/path/to/ArduinoJson/src
+//
+// Prints each failed check and exits with status 1 if there was one.
+
+#include "NodeDecisionLibrary.h"
+#include <memory>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool passed, const char *what, const char *graph, uint32_t options)
+{
+    if (!passed)
+    {
+        printf("FAIL %s: %s (options 0x%02x)\n", graph, what, static_cast<unsigned>(options));
+        failures++;
+    }
+}
+
+// One sensor reading and the value the device's final node should then hold
+struct Step
+{
+    const char *values; // entries of "sensorArray"
+    bool expected;
+};
+
+struct Graph
+{
+    const char *name;
+    const char *json;
+    std::vector<Step> steps;
+};
+
+static const int DEVICE_ID = 500;
+
+// Every graph ends in one FINAL node, so the device reports a single value
+static std::vector<Graph> graphs()
+{
+    std::vector<Graph> list;
+
+    list.push_back({"threshold",
+                    R"({"data":{"n":[
+        {"id":1,"aId":30,"k":"sensor","i":[],"o":[{"id":11,"dt":"number","dId":101,"cId":1}]},
+        {"id":2,"aId":20,"k":"gt","i":[{"id":21,"dt":"number"},{"id":22,"dt":"number","d":30}],"o":[{"id":23,"dt":"boolean","dId":0,"cId":1}]},
+        {"id":3,"aId":28,"k":"relay","i":[{"id":31,"dt":"boolean"}],"o":[]}],
+        "r":[{"id":1,"i":21,"o":11,"c":1},{"id":2,"i":31,"o":23,"c":1}]}})",
+                    {{R"({"deviceId":101,"value":35})", true},
+                     {R"({"deviceId":101,"value":20})", false},
+                     {R"({"deviceId":101,"value":30.5})", true},
+                     {R"({"deviceId":101,"value":"12"})", false}}});
+
+    // (a AND b) XOR (NOT c), where a, b and c are sensors above 0
+    list.push_back({"gates",
+                    R"({"data":{"n":[
+        {"id":1,"aId":30,"k":"sensor","i":[],"o":[{"id":11,"dt":"number","dId":101,"cId":1}]},
+        {"id":2,"aId":30,"k":"sensor","i":[],"o":[{"id":12,"dt":"number","dId":102,"cId":1}]},
+        {"id":3,"aId":30,"k":"sensor","i":[],"o":[{"id":13,"dt":"number","dId":103,"cId":1}]},
+        {"id":4,"aId":20,"k":"gt","i":[{"id":41,"dt":"number"},{"id":42,"dt":"number","d":0}],"o":[{"id":43,"dt":"boolean","dId":0,"cId":1}]},
+        {"id":5,"aId":20,"k":"gt","i":[{"id":51,"dt":"number"},{"id":52,"dt":"number","d":0}],"o":[{"id":53,"dt":"boolean","dId":0,"cId":1}]},
+        {"id":6,"aId":20,"k":"gt","i":[{"id":61,"dt":"number"},{"id":62,"dt":"number","d":0}],"o":[{"id":63,"dt":"boolean","dId":0,"cId":1}]},
+        {"id":7,"aId":2,"k":"and","i":[{"id":71,"dt":"boolean"},{"id":72,"dt":"boolean"}],"o":[{"id":73,"dt":"boolean","dId":0,"cId":1}]},
+        {"id":8,"aId":1,"k":"not","i":[{"id":81,"dt":"boolean"}],"o":[{"id":83,"dt":"boolean","dId":0,"cId":1}]},
+        {"id":9,"aId":4,"k":"xor","i":[{"id":91,"dt":"boolean"},{"id":92,"dt":"boolean"}],"o":[{"id":93,"dt":"boolean","dId":0,"cId":1}]},
+        {"id":10,"aId":28,"k":"relay","i":[{"id":101,"dt":"boolean"}],"o":[]}],
+        "r":[{"id":1,"i":41,"o":11,"c":1},{"id":2,"i":51,"o":12,"c":1},{"id":3,"i":61,"o":13,"c":1},
+             {"id":4,"i":71,"o":43,"c":1},{"id":5,"i":72,"o":53,"c":1},{"id":6,"i":81,"o":63,"c":1},
+             {"id":7,"i":91,"o":73,"c":1},{"id":8,"i":92,"o":83,"c":1},{"id":9,"i":101,"o":93,"c":1}]}})",
+                    {}});
+    for (int bits = 0; bits < 8; bits++)
+    {
+        const bool a = bits & 1, b = bits & 2, c = bits & 4;
+        list.back().steps.push_back({nullptr, (a && b) != !c}); // readings from gateReading
+    }
+
+    list.push_back({"string",
+                    R"({"data":{"n":[
+        {"id":1,"aId":30,"k":"sensor","i":[],"o":[{"id":11,"dt":"string","dId":101,"cId":1}]},
+        {"id":2,"aId":23,"k":"eq","i":[{"id":21,"dt":"string"},{"id":22,"dt":"string","d":"on"}],"o":[{"id":23,"dt":"boolean","dId":0,"cId":1}]},
+        {"id":3,"aId":28,"k":"relay","i":[{"id":31,"dt":"boolean"}],"o":[]}],
+        "r":[{"id":1,"i":21,"o":11,"c":1},{"id":2,"i":31,"o":23,"c":1}]}})",
+                    {{R"({"deviceId":101,"value":"on"})", true},
+                     {R"({"deviceId":101,"value":"off"})", false},
+                     {R"({"deviceId":101,"value":"idle"})", false},
+                     {R"({"deviceId":101,"value":"on"})", true}}});
+
+    // (a + b) * 2 - 3 > 10
+    list.push_back({"math",
+                    R"({"data":{"n":[
+        {"id":1,"aId":30,"k":"sensor","i":[],"o":[{"id":11,"dt":"number","dId":101,"cId":1}]},
+        {"id":2,"aId":30,"k":"sensor","i":[],"o":[{"id":12,"dt":"number","dId":102,"cId":1}]},
+        {"id":3,"aId":8,"k":"add","i":[{"id":31,"dt":"number"},{"id":32,"dt":"number"}],"o":[{"id":33,"dt":"number","dId":0,"cId":1}]},
+        {"id":4,"aId":10,"k":"mul","i":[{"id":41,"dt":"number"},{"id":42,"dt":"number","d":2}],"o":[{"id":43,"dt":"number","dId":0,"cId":1}]},
+        {"id":5,"aId":9,"k":"sub","i":[{"id":51,"dt":"number"},{"id":52,"dt":"number","d":3}],"o":[{"id":53,"dt":"number","dId":0,"cId":1}]},
+        {"id":6,"aId":20,"k":"gt","i":[{"id":61,"dt":"number"},{"id":62,"dt":"number","d":10}],"o":[{"id":63,"dt":"boolean","dId":0,"cId":1}]},
+        {"id":7,"aId":28,"k":"relay","i":[{"id":71,"dt":"boolean"}],"o":[]}],
+        "r":[{"id":1,"i":31,"o":11,"c":1},{"id":2,"i":32,"o":12,"c":1},{"id":3,"i":41,"o":33,"c":1},
+             {"id":4,"i":51,"o":43,"c":1},{"id":5,"i":61,"o":53,"c":1},{"id":6,"i":71,"o":63,"c":1}]}})",
+                    {{R"({"deviceId":101,"value":4},{"deviceId":102,"value":3})", true},
+                     {R"({"deviceId":101,"value":4},{"deviceId":102,"value":2})", false},
+                     {R"({"deviceId":101,"value":4},{"deviceId":102,"value":3.6})", true},
+                     {R"({"deviceId":101,"value":3},{"deviceId":102,"value":3})", false},
+                     {R"({"deviceId":101,"value":-8},{"deviceId":102,"value":20})", true}}});
+
+    // FLOOR(b NOT EQUAL a) over string sensors: the comparison feeds math, so
+    // fusing must not turn the strings into numbers
+    list.push_back({"string into math",
+                    R"({"data":{"n":[
+        {"id":1,"aId":30,"k":"sensor","i":[],"o":[{"id":11,"dt":"string","dId":105,"cId":1}]},
+        {"id":2,"aId":30,"k":"sensor","i":[],"o":[{"id":12,"dt":"string","dId":109,"cId":1}]},
+        {"id":3,"aId":24,"k":"ne","i":[{"id":31,"dt":"string"},{"id":32,"dt":"string"}],"o":[{"id":33,"dt":"boolean","dId":0,"cId":1}]},
+        {"id":4,"aId":26,"k":"floor","i":[{"id":41,"dt":"number"}],"o":[{"id":43,"dt":"number","dId":0,"cId":1}]},
+        {"id":5,"aId":28,"k":"relay","i":[{"id":51,"dt":"boolean"}],"o":[]}],
+        "r":[{"id":1,"i":31,"o":12,"c":1},{"id":2,"i":32,"o":11,"c":1},{"id":3,"i":41,"o":33,"c":1},
+             {"id":4,"i":51,"o":43,"c":1}]}})",
+                    {{R"({"deviceId":105,"value":"on"},{"deviceId":109,"value":"off"})", true},
+                     {R"({"deviceId":109,"value":"on"})", false},
+                     {R"({"deviceId":109,"value":"idle"})", true},
+                     {R"({"deviceId":105,"value":"idle"})", false},
+                     {R"({"deviceId":105,"value":7},{"deviceId":109,"value":"7"})", false}}});
+    return list;
+}
+
+// Sensor readings of step bits of the gates graph: a, b and c are its bits
+static std::string gateReading(int bits)
+{
+    const bool a = bits & 1, b = bits & 2, c = bits & 4;
+    return "{\"deviceId\":101,\"value\":" + std::to_string(a) + "},{\"deviceId\":102,\"value\":" + std::to_string(b) +
+           "},{\"deviceId\":103,\"value\":" + std::to_string(c) + "}";
+}
+
+// Engine whose callback records the device's last reported value. Fixed
+// capacity engines are large, so they are not put on the stack.
+struct Harness
+{
+    std::unique_ptr<NodeDecisionLibrary> engine;
+    int last = -1;
+    std::vector<int> reports; // last after each step
+
+    Harness() : engine(new NodeDecisionLibrary)
+    {
+        engine->setDebounceDuration(0);
+        engine->setCallback([this](int deviceId, bool value)
+                            { if (deviceId == DEVICE_ID) last = value; });
+    }
+
+    bool runSteps(const Graph &graph)
+    {
+        bool passed = true;
+        for (size_t i = 0; i < graph.steps.size(); i++)
+        {
+            const std::string values = graph.steps[i].values ? graph.steps[i].values : gateReading(static_cast<int>(i));
+            String payload("{\"sensorArray\":[" + values + "]}");
+            engine->updateDeviceValues(payload);
+            engine->processPendingChanges();
+            reports.push_back(last);
+            if (last != graph.steps[i].expected)
+            {
+                printf("  step %zu: %s reported %d, expected %d\n", i, values.c_str(), last, graph.steps[i].expected);
+                passed = false;
+            }
+        }
+        return passed;
+    }
+};
+
+// Returns what the decoded logic reported at each step
+static std::vector<int> testGraph(const Graph &graph, uint32_t options)
+{
+    Harness decoded;
+    decoded.engine->setCompileOptions(options);
+    check(decoded.engine->decodeLogicData(String(graph.json), DEVICE_ID), "decodeLogicData", graph.name, options);
+    check(decoded.runSteps(graph), "decoded logic", graph.name, options);
+
+    std::vector<uint8_t> image;
+    check(decoded.engine->exportProgram(DEVICE_ID, image), "exportProgram", graph.name, options);
+    Harness loaded;
+    check(loaded.engine->loadProgram(DEVICE_ID, image.data(), image.size()), "loadProgram", graph.name, options);
+    check(loaded.runSteps(graph), "loaded program", graph.name, options);
+
+    std::vector<uint8_t> again;
+    check(loaded.engine->exportProgram(DEVICE_ID, again) && again == image, "export of a loaded program", graph.name,
+          options);
+    return decoded.reports;
+}
+
+// A refused image must leave the device running the program it had
+static void testDamagedImages(const Graph &graph)
+{
+    Harness source;
+    source.engine->setCompileOptions(NodeDecisionLibrary::COMPILE_BYTECODE);
+    source.engine->decodeLogicData(String(graph.json), DEVICE_ID);
+    std::vector<uint8_t> image;
+    source.engine->exportProgram(DEVICE_ID, image);
+
+    Harness target;
+    target.engine->loadProgram(DEVICE_ID, image.data(), image.size());
+
+    int accepted = 0;
+    for (size_t size = 0; size < image.size(); size++)
+    {
+        std::vector<uint8_t> truncated(image.begin(), image.begin() + size);
+        accepted += target.engine->loadProgram(DEVICE_ID, truncated.data(), truncated.size());
+    }
+    check(accepted == 0, "truncated image loaded", graph.name, NodeDecisionLibrary::COMPILE_BYTECODE);
+
+    accepted = 0;
+    for (size_t byte = 0; byte < image.size(); byte++)
+    {
+        for (int bit = 0; bit < 8; bit++)
+        {
+            std::vector<uint8_t> flipped = image;
+            flipped[byte] ^= 1 << bit;
+            accepted += target.engine->loadProgram(DEVICE_ID, flipped.data(), flipped.size());
+        }
+    }
+    check(accepted == 0, "image with a flipped bit loaded", graph.name, NodeDecisionLibrary::COMPILE_BYTECODE);
+
+    // An image of another version, with a checksum that matches it
+    std::vector<uint8_t> older(image.begin(), image.end() - 4);
+    older[sizeof(BYTECODE_MAGIC)] = BYTECODE_VERSION - 1;
+    const uint32_t checksum = bytecodeChecksum(older.data(), older.size());
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        older.push_back(static_cast<uint8_t>(checksum >> shift));
+    }
+    check(!target.engine->loadProgram(DEVICE_ID, older.data(), older.size()), "image of another version loaded",
+          graph.name, NodeDecisionLibrary::COMPILE_BYTECODE);
+
+    std::vector<uint8_t> longer = image;
+    longer.push_back(0);
+    check(!target.engine->loadProgram(DEVICE_ID, longer.data(), longer.size()), "image with trailing bytes loaded",
+          graph.name, NodeDecisionLibrary::COMPILE_BYTECODE);
+
+    check(target.runSteps(graph), "program kept after refused images", graph.name,
+          NodeDecisionLibrary::COMPILE_BYTECODE);
+}
+
+int main()
+{
+    const uint32_t optionSets[] = {
+        0,
+        NodeDecisionLibrary::COMPILE_BDD,
+        NodeDecisionLibrary::COMPILE_LOOKUP,
+        NodeDecisionLibrary::COMPILE_MINIMIZE,
+        NodeDecisionLibrary::COMPILE_FUSE,
+        NodeDecisionLibrary::COMPILE_BYTECODE,
+        NodeDecisionLibrary::COMPILE_DEFAULT,
+        NodeDecisionLibrary::COMPILE_BDD | NodeDecisionLibrary::COMPILE_MINIMIZE | NodeDecisionLibrary::COMPILE_FUSE,
+        NodeDecisionLibrary::COMPILE_DEFAULT | NodeDecisionLibrary::COMPILE_MINIMIZE |
+            NodeDecisionLibrary::COMPILE_BYTECODE,
+    };
+
+    const std::vector<Graph> list = graphs();
+    for (const Graph &graph : list)
+    {
+        const std::vector<int> plain = testGraph(graph, optionSets[0]);
+        for (size_t k = 1; k < sizeof(optionSets) / sizeof(optionSets[0]); k++)
+        {
+            check(testGraph(graph, optionSets[k]) == plain, "reports differ from no compile options", graph.name,
+                  optionSets[k]);
+        }
+        testDamagedImages(graph);
+    }
+
+    printf(failures == 0 ? "All checks passed\n" : "%d checks failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}